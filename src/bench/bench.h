@@ -0,0 +1,55 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+
+using BenchFunc_t = void (*)();
+
+
+bool register_bench(const char* name, BenchFunc_t func);
+
+void bench_report(const char* name, double items, const char* unit, double seconds);
+
+// Synthetic 'threadtime' log lines with realistic field widths and a few malformed ones mixed in.
+std::vector<std::string> synthetic_lines(size_t count, unsigned seed = 1);
+
+// The lines as 'logcat -B' writes them, with v2, v3 or v4 headers, malformed ones left out.
+// The v2 euids include values that are event log ids in v3.
+std::string encode_binary(const std::vector<std::string>& lines, int version = 4);
+
+
+template<typename F>
+double bench_seconds(F&& func)
+{
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    const auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(stop - start).count();
+}
+
+
+#define BENCH_REGISTER(name, func) \
+    static const bool bench_registered_##func = register_bench(name, &func)
+
+
+#endif // BENCH_H
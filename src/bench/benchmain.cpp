@@ -0,0 +1,48 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "bench.h"
+
+#include <cstring>
+#include <utility>
+
+
+static std::vector<std::pair<const char*, BenchFunc_t>>& benches()
+{
+    static std::vector<std::pair<const char*, BenchFunc_t>> list;
+    return list;
+}
+
+
+bool register_bench(const char* name, BenchFunc_t func)
+{
+    benches().emplace_back(name, func);
+    return true;
+}
+
+
+int main(int argc, char* argv[])
+{
+    for (const auto& [name, func] : benches()) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i) {
+            if (std::strcmp(argv[i], name) == 0) { selected = true; }
+        }
+        if (selected) { func(); }
+    }
+    return 0;
+}
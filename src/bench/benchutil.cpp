@@ -0,0 +1,112 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "bench.h"
+#include "logcatparser.h"
+
+#include <cstdio>
+#include <ctime>
+#include <random>
+
+
+void bench_report(const char* name, double items, const char* unit, double seconds)
+{
+    std::printf("%-40s %12.0f %s/s  (%.3f s)\n", name, seconds > 0 ? items / seconds : 0.0, unit, seconds);
+    std::fflush(stdout);
+}
+
+
+std::vector<std::string> synthetic_lines(size_t count, unsigned seed)
+{
+    static const char* tags[] = {"ActivityManager", "WindowManager", "chatty", "PackageManager", "SurfaceFlinger",
+                                 "AndroidRuntime", "System.err", "art", "Zygote", "InputDispatcher"};
+    static const char* messages[] = {
+        "Start proc 12345:com.example.app/u0a123 for activity {com.example.app/.MainActivity}",
+        "FATAL EXCEPTION: main",
+        "uid=1000(system) Binder:1234_5 expire 3 lines",
+        "Displayed com.example.app/.MainActivity: +512ms",
+        "Background concurrent copying GC freed 12345(1024KB) AllocSpace objects, 12(512KB) LOS objects",
+        "at com.example.app.MainActivity.onCreate(MainActivity.java:42)",
+        "Channel is unrecoverably broken and will be disposed!",
+        ""
+    };
+    static const char priorities[] = "VDIWEF";
+
+    auto rng = std::mt19937(seed);
+    auto lines = std::vector<std::string>();
+    lines.reserve(count);
+    char buf[512];
+    for (size_t i = 0; i < count; ++i) {
+        if (rng() % 1000 == 0) {
+            lines.emplace_back("--------- beginning of main");
+            continue;
+        }
+        const auto ms = static_cast<unsigned>(i);
+        std::snprintf(buf, sizeof(buf), "10-%02u %02u:%02u:%02u.%03u %5u %5u %c %-8s: %s",
+                      1 + (ms / 86400000u) % 28, (ms / 3600000u) % 24, (ms / 60000u) % 60, (ms / 1000u) % 60, ms % 1000u,
+                      static_cast<unsigned>(100 + rng() % 30000), static_cast<unsigned>(100 + rng() % 30000), priorities[rng() % 6],
+                      tags[rng() % (sizeof(tags) / sizeof(tags[0]))], messages[rng() % (sizeof(messages) / sizeof(messages[0]))]);
+        lines.emplace_back(buf);
+    }
+    return lines;
+}
+
+
+static void put_le(std::string& out, uint32_t v, int size)
+{
+    for (int i = 0; i < size; ++i) { out += static_cast<char>((v >> (8 * i)) & 0xff); }
+}
+
+
+std::string encode_binary(const std::vector<std::string>& lines, int version)
+{
+    static const uint32_t euids[] = {1000, 2, 5, 6, 0, 10057};
+
+    auto now = std::time(nullptr);
+    auto tm = *std::localtime(&now);
+    auto out = std::string();
+    auto row = LogcatRow_t();
+    size_t n = 0;
+    for (const auto& line : lines) {
+        if (! parse_threadtime_line(line.data(), line.size(), row)) { continue; }
+        // the local time of the line in the current year
+        int msec = 0;
+        if (std::sscanf(line.c_str(), "%d-%d %d:%d:%d.%d", &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &msec) != 6) {
+            continue;
+        }
+        tm.tm_mon -= 1;
+        tm.tm_isdst = -1;
+        const auto sec = std::mktime(&tm);
+
+        auto payload = std::string(1, static_cast<char>(static_cast<int>(row.priority) + 1));
+        payload.append(line, row.tag_offset, row.tag_size);
+        payload += '\0';
+        payload.append(line, row.message_offset, row.size - row.message_offset);
+        payload += '\0';
+
+        put_le(out, static_cast<uint32_t>(payload.size()), 2);
+        put_le(out, version == 4 ? 28 : 24, 2);
+        put_le(out, static_cast<uint32_t>(row.pid), 4);
+        put_le(out, static_cast<uint32_t>(row.tid), 4);
+        put_le(out, static_cast<uint32_t>(sec), 4);
+        put_le(out, static_cast<uint32_t>(msec) * 1000000, 4);
+        put_le(out, version == 2 ? euids[n++ % (sizeof(euids) / sizeof(euids[0]))] : 0, 4);
+        if (version == 4) { put_le(out, 1000, 4); }
+        out += payload;
+    }
+    return out;
+}
@@ -0,0 +1,123 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "bench.h"
+#include "logcatfilter.h"
+#include "logcatparser.h"
+
+#include <cstdio>
+#include <string>
+
+
+static void run_filter_bench()
+{
+    const auto lines = synthetic_lines(2000000);
+    auto store = LogcatStore();
+    auto row = LogcatRow_t();
+    for (const auto& line : lines) {
+        if (parse_threadtime_line(line.data(), line.size(), row)) { store.append(line.data(), row); }
+    }
+
+    auto strings = LogcatStringTable();
+    auto processes = LogcatProcessList_t();
+    for (int pid = 100; pid < 30100; ++pid) {
+        auto& info = processes[pid];
+        info.ppid = 1;
+        info.name_id = strings.intern(QStringLiteral("com.example.app%1").arg(pid % 300));
+        info.pid_text = QString::number(pid);
+        info.ppid_text = QStringLiteral("1");
+    }
+
+    auto pattern = LogcatFilterPattern_t {
+        {PRIORITY_Regex, QStringLiteral("[WEF]")},
+        {NAME_Regex, QStringLiteral("app1")},
+        {TAG_Regex, QStringLiteral("Manager")}
+    };
+
+    // the previous per-row path: every field converted to a QString and matched with a regex
+    const auto priority_re = QRegularExpression(pattern[PRIORITY_Regex]);
+    const auto name_re = QRegularExpression(pattern[NAME_Regex]);
+    const auto tag_re = QRegularExpression(pattern[TAG_Regex]);
+    size_t accepted_regex = 0;
+    const auto t_regex = bench_seconds([&]() {
+        for (size_t i = 0; i < store.size(); ++i) {
+            const auto& r = store.row(i);
+            const auto priority = QString::fromUtf8(store.priority(i).data(), static_cast<int>(store.priority(i).size()));
+            if (! priority.contains(priority_re)) { continue; }
+            auto it = processes.find(QString::number(r.pid).toInt());
+            const auto name = it != processes.end() ? strings.at(it->second.name_id) : QString();
+            if (! name.contains(name_re)) { continue; }
+            const auto tag = QString::fromUtf8(store.tag(i).data(), static_cast<int>(store.tag(i).size()));
+            if (! tag.contains(tag_re)) { continue; }
+            accepted_regex += 1;
+        }
+    });
+    bench_report("filter/per-row regex", store.size(), "rows", t_regex);
+
+    auto filter = LogcatFilter(pattern);
+    filter.bind(&store, &processes, &strings);
+    size_t accepted = 0;
+    const auto t_compiled = bench_seconds([&]() {
+        for (size_t i = 0; i < store.size(); ++i) { accepted += filter.accepts(i); }
+    });
+    bench_report("filter/compiled", store.size(), "rows", t_compiled);
+
+    if (accepted != accepted_regex) {
+        std::printf("filter/compiled: accepted %zu rows, expected %zu\n", accepted, accepted_regex);
+    }
+}
+
+BENCH_REGISTER("filter", run_filter_bench);
+
+
+static void run_refilter_bench()
+{
+    const auto lines = synthetic_lines(2000000);
+    auto store = LogcatStore();
+    auto row = LogcatRow_t();
+    for (const auto& line : lines) {
+        if (parse_threadtime_line(line.data(), line.size(), row)) { store.append(line.data(), row); }
+    }
+
+    auto pattern = LogcatFilterPattern_t {
+        {PRIORITY_Regex, QStringLiteral("[DIWEF]")},
+        {TAG_Regex, QStringLiteral("Manager|Service")}
+    };
+    auto filter = LogcatFilter(pattern);
+    filter.bind(&store, nullptr, nullptr);
+
+    const auto snapshot = store.sealedSnapshot();
+    const auto detached = filter.detached();
+    const auto cancelled = std::atomic<bool>(false);
+    size_t expected = 0;
+    for (int threads : {1, 2, 4, 8}) {
+        auto accepted = std::vector<uint64_t>();
+        const auto t = bench_seconds([&]() {
+            filter_snapshot(detached, snapshot, threads, cancelled, accepted);
+        });
+        const auto name = "refilter/" + std::to_string(threads) + " threads";
+        bench_report(name.c_str(), static_cast<double>(snapshot.size), "rows", t);
+
+        if (threads == 1) {
+            expected = accepted.size();
+        } else if (accepted.size() != expected) {
+            std::printf("%s: accepted %zu rows, expected %zu\n", name.c_str(), accepted.size(), expected);
+        }
+    }
+}
+
+BENCH_REGISTER("refilter", run_refilter_bench);
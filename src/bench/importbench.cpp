@@ -0,0 +1,69 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "bench.h"
+#include "logcatparser.h"
+
+#include <QTemporaryFile>
+
+
+static void run_import_bench()
+{
+    const auto lines = synthetic_lines(4000000);
+    auto file = QTemporaryFile();
+    if (! file.open()) {
+        std::printf("import: cannot create a temporary file\n");
+        return;
+    }
+    for (const auto& line : lines) {
+        file.write(line.data(), static_cast<qint64>(line.size()));
+        file.write("\n", 1);
+    }
+    file.flush();
+
+    const auto size = static_cast<size_t>(file.size());
+    const auto data = reinterpret_cast<const char*>(file.map(0, file.size()));
+    if (! data) {
+        std::printf("import: cannot map the temporary file\n");
+        return;
+    }
+
+    const auto chunk_bytes = static_cast<size_t>(4 * 1024 * 1024);
+    const auto megabytes = static_cast<double>(size) / (1024 * 1024);
+    size_t expected = 0;
+    for (int threads : {1, 2, 4, 8}) {
+        size_t rows = 0;
+        const auto t = bench_seconds([&]() {
+            const auto ends = split_lines(data, size, chunk_bytes);
+            auto parsed = std::vector<LogcatBatchList_t>();
+            parse_chunks(data, 0, ends, threads, 1024, 256 * 1024, parsed);
+            for (const auto& chunk : parsed) {
+                for (const auto& batch : chunk) { rows += batch->rows.size(); }
+            }
+        });
+        const auto name = "import/" + std::to_string(threads) + " threads";
+        bench_report(name.c_str(), megabytes, "MB", t);
+
+        if (threads == 1) {
+            expected = rows;
+        } else if (rows != expected) {
+            std::printf("%s: parsed %zu rows, expected %zu\n", name.c_str(), rows, expected);
+        }
+    }
+}
+
+BENCH_REGISTER("import", run_import_bench);
@@ -0,0 +1,224 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "bench.h"
+#include "logcatfilter.h"
+#include "logcatmessageindex.h"
+#include "logcatparser.h"
+#include "logcattagindex.h"
+#include "logcattimeindex.h"
+
+#include <cctype>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <utility>
+
+
+static std::string fold_ascii(std::string s)
+{
+    for (auto& c : s) { c = static_cast<char>(std::tolower(static_cast<unsigned char>(c))); }
+    return s;
+}
+
+
+// Every literal the message index is asked for must occur in a message the pattern matches.
+static void check_required_literals()
+{
+    const std::pair<const char*, const char*> cases[] = {
+        {"Dead\\x41BC", "DeadABC"},
+        {"Dead\\x{41}BC", "DeadABC"},
+        {"Dead\\101BC", "DeadABC"},
+        {"Dead\\011BC", "Dead\tBC"},
+        {"Dead\\cJfoo", "Dead\nfoo"},
+        {"Dead\\p{Lu}BC", "DeadABC"},
+        {"(?x) Dead Object", "DeadObject"},
+        {"(?ix) dead object", "DeadObject"},
+        {"(?i-x:Dead) Object", "Dead Object"},
+        {"Dead\\d+Object", "Dead42Object"},
+        {"Dead\\.Object", "Dead.Object"},
+    };
+    for (const auto& [regex, message] : cases) {
+        const auto filter = LogcatFilter({{MESSAGE_Regex, QString::fromUtf8(regex)}});
+        for (const auto& literal : filter.messageLiterals()) {
+            if (fold_ascii(message).find(fold_ascii(literal)) == std::string::npos) {
+                std::printf("index/literals: \"%s\" is not in \"%s\" matched by %s\n", literal.c_str(), message, regex);
+            }
+        }
+    }
+}
+
+
+static void run_index_bench()
+{
+    check_required_literals();
+
+    const size_t Rows = 5000000;
+    const auto needle = std::string("DeadObjectException");
+
+    // every line gets a unique id so that trigram lists are not all alike, a few carry the needle
+    auto store = LogcatStore();
+    auto row = LogcatRow_t();
+    for (size_t done = 0; done < Rows;) {
+        auto lines = synthetic_lines(500000, static_cast<unsigned>(done + 1));
+        for (auto& line : lines) {
+            line += " id=" + std::to_string(done * 7919 % 1000003);
+            if (done % 10000 == 0) { line += " " + needle; }
+            done += 1;
+            if (parse_threadtime_line(line.data(), line.size(), row)) { store.append(line.data(), row); }
+        }
+    }
+
+    auto index = LogcatMessageIndex();
+    const auto t_build = bench_seconds([&]() {
+        for (size_t i = 0; i < store.size(); ++i) { index.append(store.firstSeq() + i, store.message(i)); }
+    });
+    bench_report("index/build", store.size(), "rows", t_build);
+    std::printf("index/memory %35.1f MB\n", index.memoryUsage() / (1024.0 * 1024.0));
+
+    auto filter = LogcatFilter({{MESSAGE_Regex, QString::fromStdString(needle)}});
+    filter.bind(&store, nullptr, nullptr);
+
+    size_t scanned = 0;
+    const auto t_scan = bench_seconds([&]() {
+        for (size_t i = 0; i < store.size(); ++i) { scanned += filter.accepts(i); }
+    });
+    bench_report("index/regex scan", store.size(), "rows", t_scan);
+
+    size_t found = 0;
+    auto candidates = std::vector<uint64_t>();
+    const auto t_search = bench_seconds([&]() {
+        index.candidates(filter.messageLiterals(), candidates);
+        for (auto seq : candidates) { found += filter.accepts(static_cast<size_t>(seq - store.firstSeq())); }
+    });
+    bench_report("index/search", store.size(), "rows", t_search);
+    std::printf("index/search %zu candidates, %zu rows found\n", candidates.size(), found);
+
+    if (found != scanned) {
+        std::printf("index/search: found %zu rows, expected %zu\n", found, scanned);
+    }
+}
+
+BENCH_REGISTER("index", run_index_bench);
+
+
+static void run_time_index_bench()
+{
+    const size_t Rows = 2000000;
+    const size_t Jumps = 1000;
+
+    // neighbouring lines are swapped now and then, as rows of different buffers are interleaved
+    auto lines = synthetic_lines(Rows);
+    auto rng = std::mt19937(7);
+    for (size_t i = 1; i < lines.size(); ++i) {
+        if (rng() % 50 == 0) { std::swap(lines[i - 1], lines[i]); }
+    }
+    auto store = LogcatStore();
+    auto row = LogcatRow_t();
+    for (const auto& line : lines) {
+        if (parse_threadtime_line(line.data(), line.size(), row)) { store.append(line.data(), row); }
+    }
+
+    auto index = LogcatTimeIndex();
+    const auto t_build = bench_seconds([&]() {
+        for (size_t i = 0; i < store.size(); ++i) { index.append(store.firstSeq() + i, store.row(i).timestamp); }
+    });
+    bench_report("timeindex/build", store.size(), "rows", t_build);
+    std::printf("timeindex/memory %31.1f KB\n", index.memoryUsage() / 1024.0);
+
+    auto targets = std::vector<LogcatTimestamp_t>();
+    for (size_t i = 0; i < Jumps; ++i) { targets.push_back(store.row(rng() % store.size()).timestamp); }
+
+    auto scanned = std::vector<size_t>();
+    const auto t_scan = bench_seconds([&]() {
+        for (auto t : targets) {
+            size_t i = 0;
+            while (i < store.size() && store.row(i).timestamp < t) { ++i; }
+            scanned.push_back(i);
+        }
+    });
+    bench_report("timeindex/jump by scan", Jumps, "jumps", t_scan);
+
+    auto found = std::vector<size_t>();
+    const auto t_jump = bench_seconds([&]() {
+        for (auto t : targets) {
+            auto i = static_cast<size_t>(index.range(t, t).first - store.firstSeq());
+            while (i < store.size() && store.row(i).timestamp < t) { ++i; }
+            found.push_back(i);
+        }
+    });
+    bench_report("timeindex/jump", Jumps, "jumps", t_jump);
+
+    if (found != scanned) {
+        std::printf("timeindex/jump: results differ from the scan\n");
+    }
+}
+
+BENCH_REGISTER("timeindex", run_time_index_bench);
+
+
+static void run_tag_index_bench()
+{
+    const size_t Rows = 5000000;
+
+    auto store = LogcatStore();
+    auto row = LogcatRow_t();
+    for (size_t done = 0; done < Rows; done += 500000) {
+        for (const auto& line : synthetic_lines(500000, static_cast<unsigned>(done + 1))) {
+            if (parse_threadtime_line(line.data(), line.size(), row)) { store.append(line.data(), row); }
+        }
+    }
+
+    auto index = LogcatTagIndex();
+    const auto t_build = bench_seconds([&]() {
+        for (size_t i = 0; i < store.size(); ++i) {
+            index.append(store.firstSeq() + i, store.tag(i), store.row(i).priority);
+        }
+    });
+    bench_report("tagindex/build", store.size(), "rows", t_build);
+    std::printf("tagindex/memory %32.1f MB, %zu tags\n", index.memoryUsage() / (1024.0 * 1024.0), index.tagCount());
+
+    // 'ActivityManager|art' at '>= W'
+    auto accepts_tag = [](std::string_view tag) { return tag == "ActivityManager" || tag == "art"; };
+    auto priority_mask = 0u;
+    for (int p = static_cast<int>(LogcatPriority_t::Warning); p <= static_cast<int>(LogcatPriority_t::Silent); ++p) {
+        priority_mask |= 1u << p;
+    }
+
+    auto scanned = std::vector<uint64_t>();
+    const auto t_scan = bench_seconds([&]() {
+        for (size_t i = 0; i < store.size(); ++i) {
+            if ((priority_mask & (1u << static_cast<int>(store.row(i).priority))) && accepts_tag(store.tag(i))) {
+                scanned.push_back(store.firstSeq() + i);
+            }
+        }
+    });
+    bench_report("tagindex/scan", store.size(), "rows", t_scan);
+
+    auto selected = std::vector<uint64_t>();
+    const auto t_select = bench_seconds([&]() {
+        index.select(accepts_tag, priority_mask).collect(store.firstSeq(), store.endSeq(), selected);
+    });
+    bench_report("tagindex/select", store.size(), "rows", t_select);
+    std::printf("tagindex/select %zu rows\n", selected.size());
+
+    if (selected != scanned) {
+        std::printf("tagindex/select: found %zu rows, expected %zu\n", selected.size(), scanned.size());
+    }
+}
+
+BENCH_REGISTER("tagindex", run_tag_index_bench);
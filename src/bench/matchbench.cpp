@@ -0,0 +1,86 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "bench.h"
+#include "logcatliteralmatcher.h"
+#include "logcatparser.h"
+#include "logcatstore.h"
+
+#include <QRegularExpression>
+#include <QString>
+
+#include <cstdio>
+#include <string>
+#include <utility>
+
+
+static void run_match_bench()
+{
+    const auto lines = synthetic_lines(2000000);
+    auto store = LogcatStore();
+    auto row = LogcatRow_t();
+    for (const auto& line : lines) {
+        if (parse_threadtime_line(line.data(), line.size(), row)) { store.append(line.data(), row); }
+    }
+
+    struct Case_t
+    {
+        const char* name;
+        const char* needle;
+        std::string_view (LogcatStore::*field)(size_t) const;
+    };
+    const Case_t cases[] = {
+        {"tag", "ActivityManager", &LogcatStore::tag},
+        {"message", "FATAL EXCEPTION", &LogcatStore::message},
+        {"message", "unrecoverably", &LogcatStore::message}
+    };
+    const std::pair<const char*, LogcatSimd_t> kernels[] = {
+        {"scalar", LogcatSimd_t::Scalar},
+        {"sse2", LogcatSimd_t::Sse2},
+        {"avx2", LogcatSimd_t::Avx2}
+    };
+
+    for (const auto& test : cases) {
+        const auto regex = QRegularExpression(QString::fromUtf8(test.needle));
+        size_t expected = 0;
+        const auto t_regex = bench_seconds([&]() {
+            for (size_t i = 0; i < store.size(); ++i) {
+                const auto text = (store.*test.field)(i);
+                expected += QString::fromUtf8(text.data(), static_cast<int>(text.size())).contains(regex);
+            }
+        });
+        auto name = std::string("match/") + test.name + " '" + test.needle + "' regex";
+        bench_report(name.c_str(), store.size(), "rows", t_regex);
+
+        for (const auto& [kernel, simd] : kernels) {
+            if (simd > best_simd()) { continue; }
+            size_t found = 0;
+            const auto t = bench_seconds([&]() {
+                for (size_t i = 0; i < store.size(); ++i) {
+                    found += find_literal((store.*test.field)(i), test.needle, simd) != std::string_view::npos;
+                }
+            });
+            name = std::string("match/") + test.name + " '" + test.needle + "' " + kernel;
+            bench_report(name.c_str(), store.size(), "rows", t);
+            if (found != expected) {
+                std::printf("%s: found %zu rows, expected %zu\n", name.c_str(), found, expected);
+            }
+        }
+    }
+}
+
+BENCH_REGISTER("match", run_match_bench);
@@ -0,0 +1,105 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "bench.h"
+#include "logcatmetrics.h"
+#include "logcatstreamstats.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+
+
+// Cost of recording into a histogram, alone and while another thread takes snapshots like
+// the metrics panel does, and of a steady_clock read pair that brackets a measured stage.
+static void run_metrics_bench()
+{
+    const uint64_t count = 20000000;
+    auto histogram = LogcatHistogram();
+
+    const auto t_record = bench_seconds([&histogram, count]() {
+        for (uint64_t i = 0; i < count; ++i) { histogram.record(i & 0xffff); }
+    });
+    bench_report("metrics/record", count, "values", t_record);
+
+    auto done = std::atomic<bool>(false);
+    auto reader = std::thread([&histogram, &done]() {
+        while (! done.load()) { histogram.snapshot(); }
+    });
+    const auto t_contended = bench_seconds([&histogram, count]() {
+        for (uint64_t i = 0; i < count; ++i) { histogram.record(i & 0xffff); }
+    });
+    done = true;
+    reader.join();
+    bench_report("metrics/record+snapshots", count, "values", t_contended);
+
+    uint64_t total = 0;
+    const auto t_clock = bench_seconds([&total, count]() {
+        for (uint64_t i = 0; i < count / 10; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            total += static_cast<uint64_t>((std::chrono::steady_clock::now() - start).count());
+        }
+    });
+    bench_report("metrics/clock pair", count / 10, "pairs", t_clock);
+
+    const auto s = histogram.snapshot();
+    std::printf("%-40s %12llu values, p50 %llu, p99 %llu\n", "metrics/histogram", static_cast<unsigned long long>(s.count),
+                static_cast<unsigned long long>(s.quantile(0.5)), static_cast<unsigned long long>(s.quantile(0.99)));
+    if (total == 0) { std::printf("clock did not advance\n"); }
+}
+
+BENCH_REGISTER("metrics", run_metrics_bench);
+
+
+// Cost per line of the streaming stats with a skewed key distribution, as a few chatty tags
+// and processes make most of a log, and of reading the windows as the stats pane does.
+static void run_stream_stats_bench()
+{
+    const size_t count = 20000000;
+    const size_t lines_per_msec = 200;
+
+    auto rng = std::mt19937(1);
+    auto keys = std::vector<uint64_t>(1 << 16);
+    for (auto& key : keys) { key = rng() % 8 == 0 ? rng() % 5000 : rng() % 20; }
+
+    auto stats = LogcatStreamStats();
+    const auto t_add = bench_seconds([&]() {
+        for (size_t i = 0; i < count; ++i) {
+            const auto key = keys[i & 0xffff];
+            stats.add(static_cast<int64_t>(i / lines_per_msec), key, key * 7 % 300,
+                      static_cast<LogcatPriority_t>(1 + key % 6), 100);
+        }
+    });
+    bench_report("streamstats/add", count, "lines", t_add);
+
+    const auto now = static_cast<int64_t>(count / lines_per_msec);
+    const int reads = 100;
+    auto top = std::vector<LogcatStatsEntry_t>();
+    const auto t_top = bench_seconds([&]() {
+        for (int i = 0; i < reads; ++i) {
+            top = stats.top(LogcatStatsKind_t::Tag, now, LogcatStreamStats::Max_Window_Secs, 10);
+        }
+    });
+    bench_report("streamstats/top 60 s", reads, "reads", t_top);
+    const auto total = stats.total(now, LogcatStreamStats::Max_Window_Secs);
+    std::printf("streamstats/total %.0f lines/s, top tag %llu at %.0f lines/s (+/- %.0f)\n", total.lines_per_sec,
+                top.empty() ? 0ull : static_cast<unsigned long long>(top[0].key),
+                top.empty() ? 0.0 : top[0].lines_per_sec, top.empty() ? 0.0 : top[0].error_per_sec);
+}
+
+BENCH_REGISTER("streamstats", run_stream_stats_bench);
@@ -0,0 +1,99 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "bench.h"
+#include "logcatdecoder.h"
+#include "logcatparser.h"
+
+#include <cstdio>
+#include <regex>
+
+
+static void run_parser_bench()
+{
+    const auto lines = synthetic_lines(500000);
+    size_t matched = 0;
+
+    const auto t_regex = bench_seconds([&lines, &matched]() {
+        static const auto re = std::regex(R"(^(\d+-\d+)\s+(\d+:\d+:\d+\.\d+)\s+(\d+)\s+(\d+)\s+(\w+)\s+([^:]+?)\s*:\s(.+)$)");
+        for (const auto& line : lines) {
+            std::smatch match;
+            if (std::regex_match(line, match, re)) { matched += match.length(7) > 0; }
+        }
+    });
+    bench_report("parser/std::regex", lines.size(), "lines", t_regex);
+
+    const auto t_scan = bench_seconds([&lines, &matched]() {
+        auto row = LogcatRow_t();
+        for (const auto& line : lines) {
+            if (parse_threadtime_line(line.data(), line.size(), row)) { matched += row.size > row.message_offset; }
+        }
+    });
+    bench_report("parser/parse_threadtime_line", lines.size(), "lines", t_scan);
+
+    if (matched == 0) { std::printf("no lines matched\n"); }
+}
+
+BENCH_REGISTER("parser", run_parser_bench);
+
+
+namespace {
+
+struct CountingSink : LogcatRowSink
+{
+    size_t rows = 0;
+    size_t bytes = 0;
+    void addRow(const LogcatRow_t& row, const char*) override { rows += 1; bytes += row.size; }
+};
+
+}
+
+
+static void run_decode_bench()
+{
+    const auto lines = synthetic_lines(1000000);
+    auto text = std::string();
+    for (const auto& line : lines) {
+        text += line;
+        text += '\n';
+    }
+    const auto binary = encode_binary(lines);
+
+    auto binary_sink = CountingSink();
+    for (auto format : {LogcatFormat_t::Text, LogcatFormat_t::Binary}) {
+        const auto& data = format == LogcatFormat_t::Binary ? binary : text;
+        auto decoder = make_decoder(format);
+        auto sink = CountingSink();
+        const auto t = bench_seconds([&]() { decoder->decode(data.data(), data.size(), sink); });
+        bench_report(format == LogcatFormat_t::Binary ? "decode/binary" : "decode/text", sink.rows, "rows", t);
+        binary_sink = sink;
+    }
+
+    // the older headers carry the same records
+    for (int version : {2, 3}) {
+        const auto data = encode_binary(lines, version);
+        auto decoder = make_decoder(LogcatFormat_t::Binary);
+        auto sink = CountingSink();
+        decoder->decode(data.data(), data.size(), sink);
+        if (sink.rows != binary_sink.rows || sink.bytes != binary_sink.bytes || decoder->malformed() > 0) {
+            std::printf("decode/binary v%d: %zu rows of %zu bytes, expected %zu rows of %zu bytes\n",
+                        version, sink.rows, sink.bytes, binary_sink.rows, binary_sink.bytes);
+        }
+    }
+}
+
+BENCH_REGISTER("decode", run_decode_bench);
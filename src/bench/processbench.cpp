@@ -0,0 +1,75 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "bench.h"
+#include "logcatstringtable.h"
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include <QRegularExpression>
+#include <QString>
+
+
+static void run_process_bench()
+{
+    const size_t row_count = 1000000;
+    const int process_count = 500;
+
+    auto rng = std::mt19937(1);
+    auto pids = std::vector<int>(row_count);
+    for (auto& pid : pids) { pid = 1000 + static_cast<int>(rng() % process_count); }
+
+    // before: ps lines kept as text, fields sliced out on every lookup
+    auto raw_list = std::unordered_map<int, std::string>();
+    // after: names interned once, looked up by integer pid
+    auto strings = LogcatStringTable();
+    auto name_ids = std::unordered_map<int, int>();
+    for (int i = 0; i < process_count; ++i) {
+        const auto name = "com.example.app" + std::to_string(i);
+        raw_list[1000 + i] = name;
+        name_ids[1000 + i] = strings.intern(name);
+    }
+
+    const auto re = QRegularExpression(QStringLiteral("app4[0-9]$"));
+    size_t accepted = 0;
+
+    const auto t_text = bench_seconds([&]() {
+        for (auto pid : pids) {
+            const auto pid_text = QString::number(pid);
+            auto it = raw_list.find(pid_text.toInt());
+            const auto name = it != raw_list.end() ? QString(it->second.c_str()) : QString();
+            accepted += name.contains(re);
+        }
+    });
+    bench_report("process/filter name, text pid", row_count, "rows", t_text);
+
+    const auto t_ids = bench_seconds([&]() {
+        for (auto pid : pids) {
+            auto it = name_ids.find(pid);
+            const auto& name = strings.at(it != name_ids.end() ? it->second : 0);
+            accepted += name.contains(re);
+        }
+    });
+    bench_report("process/filter name, interned", row_count, "rows", t_ids);
+
+    if (accepted == 0) { std::printf("no rows accepted\n"); }
+}
+
+BENCH_REGISTER("process", run_process_bench);
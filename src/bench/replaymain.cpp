@@ -0,0 +1,518 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Headless end-to-end benchmark: a logcat stream is replayed through LogcatDataModel and
+// LogcatFilterProxy exactly like a device capture, only logcatCommand() and psCommand()
+// start this executable in feeder mode instead of adb.
+//
+//   qLogcatReplay [--file <threadtime dump>] [--lines <n>] [--rate <lines/s>]
+//                 [--tag <regex>] [--message <regex>]
+//
+// Lines are re-stamped with the local time as they are written, so the age of a row when
+// it reaches the store is the end-to-end insert latency.
+//
+//   qLogcatReplay --reconnect <tools/fake-adb.sh> [--format text|binary] [--lines <n>]
+//
+// checks a disconnect and resume instead: the script stands in for adb, the first half of
+// the lines is replayed and logcat exits, the rest is logged meanwhile and the capture
+// resumes with -T. Every line has to show up once, after a single gap marker row; the exit
+// code is non-zero otherwise.
+
+#include "bench.h"
+#include "logcatdatamodel.h"
+#include "logcatfilterproxy.h"
+#include "logcatmetrics.h"
+#include "logcatparser.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTimer>
+
+#if defined(Q_OS_WIN)
+#include <fcntl.h>
+#include <io.h>
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+
+static const int Ps_First_Pid = 100;
+static const int Ps_Processes = 30000;
+
+
+static std::vector<std::string> load_lines(const QString& path, size_t count)
+{
+    if (path.isEmpty()) { return synthetic_lines(count); }
+
+    auto lines = std::vector<std::string>();
+    auto file = QFile(path);
+    if (! file.open(QIODevice::ReadOnly)) {
+        std::fprintf(stderr, "cannot open %s\n", qPrintable(path));
+        return lines;
+    }
+    while (! file.atEnd() && lines.size() < count) {
+        auto line = file.readLine();
+        while (line.endsWith('\n') || line.endsWith('\r')) { line.chop(1); }
+        lines.emplace_back(line.constData(), static_cast<size_t>(line.size()));
+    }
+    return lines;
+}
+
+
+// Writes the lines to stdout at `rate` lines/s (0 for as fast as the pipe takes them),
+// the recorded dump is repeated until `count` lines are written.
+static int feed(const std::vector<std::string>& lines, size_t count, double rate)
+{
+    if (lines.empty()) { return 1; }
+
+#if defined(Q_OS_WIN)
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    std::setvbuf(stdout, nullptr, _IOFBF, 64 * 1024);
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto start_time = QDateTime::currentDateTime();
+    auto stamp = std::string();
+    int64_t stamp_msecs = -1;
+
+    for (size_t i = 0; i < count; ++i) {
+        if (rate > 0) {
+            // a 1 ms tick keeps the bursts short
+            while (static_cast<double>(i) > rate * std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()) {
+                std::fflush(stdout);
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        const auto& line = lines[i % lines.size()];
+        const auto stamped = line.size() > 18 && line[2] == '-' && line[5] == ' ' && line[8] == ':';
+        if (stamped) {
+            const auto msecs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+            if (msecs != stamp_msecs) {
+                stamp_msecs = msecs;
+                stamp = start_time.addMSecs(msecs).toString(QStringLiteral("MM-dd HH:mm:ss.zzz")).toStdString();
+            }
+            std::fwrite(stamp.data(), 1, stamp.size(), stdout);
+            std::fwrite(line.data() + 18, 1, line.size() - 18, stdout);
+        } else {
+            std::fwrite(line.data(), 1, line.size(), stdout);
+        }
+        std::fputc('\n', stdout);
+    }
+    std::fflush(stdout);
+    return 0;
+}
+
+
+// 'ps -o USER,PID,PPID,NAME' for every PID of the synthetic lines.
+static int print_ps()
+{
+    std::printf("USER           PID  PPID NAME\n");
+    for (int pid = Ps_First_Pid; pid < Ps_First_Pid + Ps_Processes; ++pid) {
+        std::printf("u0_a%-9d %5d     1 com.example.app%d\n", pid % 1000, pid, pid % 500);
+    }
+    return 0;
+}
+
+
+// 'logcat -B -T <since>' of fake-adb.sh: the records of a 'logcat -B' file from `since` on,
+// 'sssss.nnn' or 'MM-DD HH:MM:SS.nnn' in the local timezone, which is the device's there.
+static int slice_binary(const QString& path, const QString& since)
+{
+    auto file = QFile(path);
+    if (! file.open(QIODevice::ReadOnly)) { return 1; }
+    const auto data = file.readAll();
+
+    const auto text = since.toStdString();
+    const auto dot = text.find('.');
+    auto digits = dot == std::string::npos ? std::string() : text.substr(dot + 1, 9);
+    digits.resize(9, '0');
+    const auto nsec = std::strtoull(digits.c_str(), nullptr, 10);
+    uint64_t from = 0;
+    if (text.find(' ') == std::string::npos) {
+        from = std::strtoull(text.c_str(), nullptr, 10) * 1000000000 + nsec;
+    } else {
+        const auto now = std::time(nullptr);
+        auto tm = *std::localtime(&now);
+        if (std::sscanf(text.c_str(), "%d-%d %d:%d:%d", &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 5) { return 1; }
+        tm.tm_mon -= 1;
+        tm.tm_isdst = -1;
+        from = static_cast<uint64_t>(std::mktime(&tm)) * 1000000000 + nsec;
+    }
+
+    // struct logger_entry: payload size, header size (0 for the 20 byte v1 one), pid, tid, sec, nsec
+    auto le = [&data](int pos, int bytes) {
+        uint32_t v = 0;
+        for (int i = bytes - 1; i >= 0; --i) { v = v << 8 | static_cast<uint8_t>(data[pos + i]); }
+        return v;
+    };
+    auto out = QByteArray();
+    int pos = 0;
+    while (pos + 20 <= data.size()) {
+        const auto header_size = le(pos + 2, 2) != 0 ? le(pos + 2, 2) : 20;
+        const auto size = static_cast<int>(header_size + le(pos, 2));
+        if (pos + size > data.size()) { break; }
+        if (static_cast<uint64_t>(le(pos + 12, 4)) * 1000000000 + le(pos + 16, 4) >= from) {
+            out.append(data.constData() + pos, size);
+        }
+        pos += size;
+    }
+#if defined(Q_OS_WIN)
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    return std::fwrite(out.constData(), 1, static_cast<size_t>(out.size()), stdout) == static_cast<size_t>(out.size()) ? 0 : 1;
+}
+
+
+static long peak_rss_kbytes()
+{
+#if defined(Q_OS_WIN)
+    auto counters = PROCESS_MEMORY_COUNTERS();
+    return K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))
+            ? static_cast<long>(counters.PeakWorkingSetSize / 1024) : 0;
+#else
+    auto usage = rusage();
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(Q_OS_MACOS)
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+
+static void print_histogram(const char* name, const char* unit, const LogcatHistogramSnapshot_t& h)
+{
+    std::printf("%-40s %12.0f %s mean, p50 %llu, p99 %llu, max %llu  (%llu samples)\n", name, h.mean(), unit,
+                static_cast<unsigned long long>(h.quantile(0.50)), static_cast<unsigned long long>(h.quantile(0.99)),
+                static_cast<unsigned long long>(h.max), static_cast<unsigned long long>(h.count));
+}
+
+
+class ReplayDataModel : public LogcatDataModel
+{
+  public:
+    ReplayDataModel(const QStringList& feed_args, QObject* parent)
+            : LogcatDataModel(parent)
+            , feed_args_(feed_args)
+    {}
+
+  protected:
+    std::tuple<QString, QStringList> logcatCommand(const QString&) const override
+    {
+        return {QCoreApplication::applicationFilePath(), QStringList {QStringLiteral("--feed")} + feed_args_};
+    }
+
+    std::tuple<QString, QStringList> psCommand(const QString&) const override
+    {
+        return {QCoreApplication::applicationFilePath(), QStringList {QStringLiteral("--ps")}};
+    }
+
+  private:
+    QStringList feed_args_;
+};
+
+
+// Lines of the reconnect scenario share a timestamp in groups, so that the disconnect
+// falls inside a group and the resume repeats some of its rows.
+static const size_t Reconnect_Group_Rows = 4;
+
+
+static int run_reconnect(QCoreApplication& app, const QString& script, LogcatFormat_t format, size_t count)
+{
+#if defined(Q_OS_WIN)
+    Q_UNUSED(app);
+    Q_UNUSED(script);
+    Q_UNUSED(format);
+    Q_UNUSED(count);
+    std::fprintf(stderr, "the reconnect scenario needs a POSIX shell for %s\n", qPrintable(script));
+    return 1;
+#else
+    // the model runs $ANDROID_SDK_ROOT/platform-tools/adb
+    auto sdk = QTemporaryDir();
+    const auto adb = sdk.filePath(QStringLiteral("platform-tools/adb"));
+    if (! sdk.isValid() || ! QDir(sdk.path()).mkpath(QStringLiteral("platform-tools")) || ! QFile::copy(script, adb)
+            || ! QFile::setPermissions(adb, QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner)) {
+        std::fprintf(stderr, "cannot install %s as adb\n", qPrintable(script));
+        return 1;
+    }
+
+    // unique messages, numbered to find repeated and missing rows
+    const auto base = QDateTime::currentDateTime();
+    auto lines = std::vector<std::string>();
+    auto row = LogcatRow_t();
+    for (const auto& line : synthetic_lines(count)) {
+        if (! parse_threadtime_line(line.data(), static_cast<ptrdiff_t>(line.size()), row)) { continue; }
+        const auto n = lines.size();
+        const auto stamp = base.addMSecs(static_cast<qint64>(n / Reconnect_Group_Rows)).toString(QStringLiteral("MM-dd HH:mm:ss.zzz"));
+        lines.push_back(stamp.toStdString() + line.substr(18) + " #" + std::to_string(n));
+    }
+    if (lines.size() < 2 * Reconnect_Group_Rows) {
+        std::fprintf(stderr, "nothing to replay\n");
+        return 1;
+    }
+
+    // fake-adb.sh skips text lines older than -T itself, binary records are sliced by this
+    // executable in the device's timezone, three hours ahead of the host, so a -T date-time
+    // read as host time would repeat or miss rows
+    const auto binary = format == LogcatFormat_t::Binary;
+    const auto slice = sdk.filePath(QStringLiteral("platform-tools/slice"));
+    auto slice_file = QFile(slice);
+    const auto slice_script = QStringLiteral("#!/bin/sh\nexec '%1' --slice \"$1\" --file \"$2\"\n")
+            .arg(QCoreApplication::applicationFilePath().replace(QStringLiteral("'"), QStringLiteral("'\\''"))).toUtf8();
+    if (! slice_file.open(QIODevice::WriteOnly) || slice_file.write(slice_script) != slice_script.size()
+            || ! slice_file.setPermissions(QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner)) {
+        std::fprintf(stderr, "cannot write %s\n", qPrintable(slice));
+        return 1;
+    }
+    slice_file.close();
+    const auto device_offset = base.offsetFromUtc() + 3 * 60 * 60;
+    const auto device_tz = QStringLiteral("DEV%1%2:%3").arg(device_offset > 0 ? QStringLiteral("-") : QStringLiteral("+"))
+            .arg(std::abs(device_offset) / 3600).arg(std::abs(device_offset) % 3600 / 60, 2, 10, QLatin1Char('0'));
+
+    const auto log_path = sdk.filePath(binary ? QStringLiteral("logcat.bin") : QStringLiteral("logcat.txt"));
+    auto write_lines = [&](size_t first, size_t last) {
+        const auto part = std::vector<std::string>(lines.begin() + static_cast<ptrdiff_t>(first), lines.begin() + static_cast<ptrdiff_t>(last));
+        auto data = std::string();
+        if (binary) {
+            data = encode_binary(part);
+        } else {
+            for (const auto& line : part) { data += line + '\n'; }
+        }
+        auto file = QFile(log_path);
+        return file.open(QIODevice::WriteOnly | QIODevice::Append) && file.write(data.data(), static_cast<qint64>(data.size())) == static_cast<qint64>(data.size());
+    };
+
+    qputenv("ANDROID_SDK_ROOT", QFile::encodeName(sdk.path()));
+    qputenv(binary ? "FAKE_ADB_LOGCAT_BINARY" : "FAKE_ADB_LOGCAT", QFile::encodeName(log_path));
+    qputenv("FAKE_ADB_SLICE", QFile::encodeName(slice));
+    qputenv("FAKE_ADB_TZ", device_tz.toUtf8());
+    qunsetenv("FAKE_ADB_HOLD");
+
+    const auto split = lines.size() / 2 / Reconnect_Group_Rows * Reconnect_Group_Rows + Reconnect_Group_Rows / 2;
+    auto logged = split;
+    if (! write_lines(0, split)) {
+        std::fprintf(stderr, "cannot write %s\n", qPrintable(log_path));
+        return 1;
+    }
+
+    auto model = LogcatDataModel(nullptr);
+    model.setLogcatFormat(format);
+    model.setReconnect(true, 1000);
+    auto failed = false;
+    QObject::connect(&model, &LogcatDataModel::reconnecting, [&]() {
+        failed = failed || ! (logged == lines.size() || write_lines(logged, lines.size()));
+        logged = lines.size();
+    });
+
+    // the third connection starts once the second resume, all repeats, has been read
+    auto timer = QElapsedTimer();
+    auto poll = QTimer();
+    QObject::connect(&poll, &QTimer::timeout, [&]() {
+        const auto stats = model.ingestStats();
+        const auto done = stats.reconnects >= 3 && model.store().size() >= stats.rows;
+        if (! done && timer.elapsed() < 30000) { return; }
+        if (! done) { std::fprintf(stderr, "replay/reconnect: stalled after %llu reconnects\n", static_cast<unsigned long long>(stats.reconnects)); }
+        poll.stop();
+        app.quit();
+    });
+
+    timer.start();
+    model.startCapture();
+    poll.start(10);
+    app.exec();
+    const auto stats = model.ingestStats();
+    model.tearDown();
+
+    auto seen = std::vector<int>(lines.size());
+    size_t markers = 0;
+    size_t marker_row = 0;
+    size_t foreign = 0;
+    const auto& store = model.store();
+    for (size_t i = 0; i < store.size(); ++i) {
+        const auto message = store.message(i);
+        const auto hash = message.rfind('#');
+        if (message.find("capture resumed after") != std::string_view::npos) {
+            markers += 1;
+            marker_row = i;
+        } else if (hash != std::string_view::npos && std::stoul(std::string(message.substr(hash + 1))) < lines.size()) {
+            seen[std::stoul(std::string(message.substr(hash + 1)))] += 1;
+        } else {
+            foreign += 1;
+        }
+    }
+    const auto repeated = std::count_if(seen.begin(), seen.end(), [](int n) { return n > 1; });
+    const auto missing = std::count(seen.begin(), seen.end(), 0);
+
+    std::printf("%-40s %12zu rows, %llu reconnects, %llu repeats skipped, %zu gap markers\n",
+                binary ? "replay/reconnect binary" : "replay/reconnect text", lines.size(),
+                static_cast<unsigned long long>(stats.reconnects), static_cast<unsigned long long>(stats.duplicates), markers);
+    auto ok = ! failed && repeated == 0 && missing == 0 && foreign == 0;
+    if (failed) { std::printf("replay/reconnect: cannot write %s\n", qPrintable(log_path)); }
+    if (repeated > 0 || missing > 0 || foreign > 0) {
+        std::printf("replay/reconnect: %lld rows repeated, %lld missing, %zu unexpected\n",
+                    static_cast<long long>(repeated), static_cast<long long>(missing), foreign);
+    }
+    // the marker goes right before the first row logged during the gap, repeats add none
+    if (markers != 1 || marker_row != split) {
+        std::printf("replay/reconnect: %zu gap markers, expected one at row %zu\n", markers, split);
+        ok = false;
+    }
+    return ok ? 0 : 1;
+#endif
+}
+
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    auto parser = QCommandLineParser();
+    parser.addHelpOption();
+    const auto file_opt = QCommandLineOption(QStringLiteral("file"), QStringLiteral("Threadtime dump to replay."), QStringLiteral("path"));
+    const auto lines_opt = QCommandLineOption(QStringLiteral("lines"), QStringLiteral("Lines to replay."), QStringLiteral("n"), QStringLiteral("1000000"));
+    const auto rate_opt = QCommandLineOption(QStringLiteral("rate"), QStringLiteral("Lines per second, 0 for unthrottled."), QStringLiteral("n"), QStringLiteral("0"));
+    const auto tag_opt = QCommandLineOption(QStringLiteral("tag"), QStringLiteral("Tag filter of the view."), QStringLiteral("regex"));
+    const auto message_opt = QCommandLineOption(QStringLiteral("message"), QStringLiteral("Message filter re-applied at the end."),
+                                                QStringLiteral("regex"), QStringLiteral("FATAL"));
+    const auto feed_opt = QCommandLineOption(QStringLiteral("feed"), QStringLiteral("Internal: write the stream to stdout."));
+    const auto ps_opt = QCommandLineOption(QStringLiteral("ps"), QStringLiteral("Internal: print the process list."));
+    const auto slice_opt = QCommandLineOption(QStringLiteral("slice"), QStringLiteral("Internal: print the binary records of --file from a 'logcat -T' time on."),
+                                              QStringLiteral("time"));
+    const auto reconnect_opt = QCommandLineOption(QStringLiteral("reconnect"), QStringLiteral("Check a disconnect and resume with the fake adb script."),
+                                                  QStringLiteral("fake-adb.sh"));
+    const auto format_opt = QCommandLineOption(QStringLiteral("format"), QStringLiteral("Logcat format of the reconnect check, text or binary."),
+                                               QStringLiteral("format"), QStringLiteral("text"));
+    parser.addOptions({file_opt, lines_opt, rate_opt, tag_opt, message_opt, feed_opt, ps_opt, slice_opt, reconnect_opt, format_opt});
+    parser.process(app);
+
+    const auto count = parser.value(lines_opt).toULongLong();
+    const auto rate = parser.value(rate_opt).toDouble();
+    if (parser.isSet(ps_opt)) { return print_ps(); }
+    if (parser.isSet(slice_opt)) { return slice_binary(parser.value(file_opt), parser.value(slice_opt)); }
+    if (parser.isSet(reconnect_opt)) {
+        const auto format = parser.value(format_opt) == QStringLiteral("binary") ? LogcatFormat_t::Binary : LogcatFormat_t::Text;
+        return run_reconnect(app, parser.value(reconnect_opt), format, count);
+    }
+
+    // the feeder replays a synthetic stream of at most 1M distinct lines
+    const auto lines = load_lines(parser.value(file_opt), std::min<size_t>(count, 1000000));
+    if (parser.isSet(feed_opt)) { return feed(lines, count, rate); }
+
+    // rows the stream will produce, malformed lines are skipped by the parser
+    size_t expected = 0;
+    auto row = LogcatRow_t();
+    for (size_t i = 0; i < count && ! lines.empty(); ++i) {
+        const auto& line = lines[i % lines.size()];
+        expected += parse_threadtime_line(line.data(), static_cast<ptrdiff_t>(line.size()), row) ? 1 : 0;
+    }
+    if (expected == 0) {
+        std::fprintf(stderr, "nothing to replay\n");
+        return 1;
+    }
+
+    auto feed_args = QStringList {QStringLiteral("--lines"), QString::number(count), QStringLiteral("--rate"), QString::number(rate)};
+    if (parser.isSet(file_opt)) { feed_args << QStringLiteral("--file") << parser.value(file_opt); }
+
+    auto model = ReplayDataModel(feed_args, nullptr);
+    model.setReconnect(false, 0);
+    auto proxy = LogcatFilterProxy(nullptr);
+    proxy.setSourceModel(&model);
+    proxy.setMetrics(model.metrics());
+    proxy.setFilterPattern({{TAG_Regex, parser.value(tag_opt)}});
+
+    auto latency = LogcatHistogram();
+    QObject::connect(&model, &QAbstractItemModel::rowsInserted, [&model, &latency](const QModelIndex&, int first, int) {
+        // the oldest row of the insert waited the longest
+        const auto now = QDateTime::currentDateTime();
+        const auto date = now.date();
+        const auto time = now.time();
+        const auto now_ts = pack_timestamp(date.month(), date.day(), time.hour(), time.minute(), time.second(), time.msec() * 1000000);
+        const auto age = timestamp_to_msecs(now_ts) - timestamp_to_msecs(model.store().row(static_cast<size_t>(first)).timestamp);
+        latency.record(static_cast<uint64_t>(std::max<int64_t>(0, age)));
+    });
+
+    auto timer = QElapsedTimer();
+    auto idle = QElapsedTimer();
+    uint64_t last_rows = 0;
+    double ingest_secs = 0.0;
+    auto poll = QTimer();
+    QObject::connect(&poll, &QTimer::timeout, [&]() {
+        const auto stats = model.ingestStats();
+        const auto done = stats.rows + stats.dropped_rows >= expected && model.store().size() >= stats.rows;
+        if (stats.rows != last_rows) {
+            last_rows = stats.rows;
+            idle.start();
+        }
+        if (! done && idle.elapsed() < 5000) { return; }
+        if (! done) { std::fprintf(stderr, "stream stalled at %llu of %zu rows\n", static_cast<unsigned long long>(stats.rows), expected); }
+        ingest_secs = static_cast<double>(timer.nsecsElapsed()) / 1e9;
+        poll.stop();
+        app.quit();
+    });
+
+    timer.start();
+    idle.start();
+    model.startCapture();
+    poll.start(10);
+    app.exec();
+
+    const auto stats = model.ingestStats();
+    const auto metrics = model.metrics();
+    bench_report("replay/ingest", static_cast<double>(stats.rows), "rows", ingest_secs);
+    bench_report("replay/ingest", static_cast<double>(stats.bytes), "bytes", ingest_secs);
+    print_histogram("replay/parse", "ns/row", metrics->parse_ns_per_line.snapshot());
+    print_histogram("replay/insert latency", "ms", latency.snapshot());
+    print_histogram("replay/insert turn", "ns", metrics->insert_ns.snapshot());
+    print_histogram("replay/insert rows", "rows", metrics->insert_rows.snapshot());
+    print_histogram("replay/filter appended", "ns", metrics->filter_ns.snapshot());
+    std::printf("%-40s %12llu rows dropped, %llu backpressured batches, %d rows in view\n", "replay/queue",
+                static_cast<unsigned long long>(stats.dropped_rows), static_cast<unsigned long long>(stats.backpressured),
+                proxy.rowCount());
+
+    // a full re-filter of the store, in the background for a large one
+    auto refilter = QElapsedTimer();
+    refilter.start();
+    proxy.setFilterPattern({{TAG_Regex, parser.value(tag_opt)}, {MESSAGE_Regex, parser.value(message_opt)}});
+    if (proxy.isRefiltering()) {
+        QObject::connect(&proxy, &LogcatFilterProxy::refilterFinished, &app, &QCoreApplication::quit);
+        app.exec();
+    }
+    bench_report("replay/refilter", static_cast<double>(model.store().size()), "rows", static_cast<double>(refilter.nsecsElapsed()) / 1e9);
+
+    std::printf("%-40s %12.1f MiB  (%.1f bytes/row in the store)\n", "replay/peak RSS", peak_rss_kbytes() / 1024.0,
+                model.store().size() > 0 ? static_cast<double>(model.memoryUsage()) / model.store().size() : 0.0);
+
+    model.tearDown();
+    return 0;
+}
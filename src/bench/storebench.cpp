@@ -0,0 +1,107 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "bench.h"
+#include "logcatcellcache.h"
+#include "logcatparser.h"
+#include "logcatstore.h"
+
+#include <algorithm>
+#include <cstdio>
+
+
+static void run_store_bench()
+{
+    const auto lines = synthetic_lines(1000000);
+    auto store = LogcatStore();
+
+    const auto t_append = bench_seconds([&lines, &store]() {
+        auto row = LogcatRow_t();
+        for (const auto& line : lines) {
+            if (parse_threadtime_line(line.data(), line.size(), row)) { store.append(line.data(), row); }
+        }
+    });
+    bench_report("store/parse+append", store.size(), "rows", t_append);
+
+    size_t text_bytes = 0;
+    const auto t_scan = bench_seconds([&store, &text_bytes]() {
+        for (size_t i = 0; i < store.size(); ++i) { text_bytes += store.message(i).size() + store.row(i).pid; }
+    });
+    bench_report("store/scan", store.size(), "rows", t_scan);
+
+    std::printf("%-40s %12.1f bytes/row  (%zu rows, %.1f MiB)\n", "store/memory", double(store.memoryUsage()) / store.size(),
+                store.size(), store.memoryUsage() / 1048576.0);
+    if (text_bytes == 0) { std::printf("empty store\n"); }
+}
+
+BENCH_REGISTER("store", run_store_bench);
+
+
+// A view scrolling 3 rows per frame through a 50-row viewport, every cell asked for twice per
+// frame (size hint and paint), with and without the display-string cache.
+static void run_cells_bench()
+{
+    const size_t viewport = 50;
+    const auto lines = synthetic_lines(200000);
+    auto store = LogcatStore();
+    auto row = LogcatRow_t();
+    for (const auto& line : lines) {
+        if (parse_threadtime_line(line.data(), line.size(), row)) { store.append(line.data(), row); }
+    }
+
+    auto cell = [&store](size_t i, int column) {
+        const auto text = column == 0 ? store.tag(i) : store.message(i);
+        return QString::fromUtf8(text.data(), static_cast<int>(text.size()));
+    };
+
+    size_t cells = 0;
+    size_t chars = 0;
+    const auto t_plain = bench_seconds([&]() {
+        for (size_t top = 0; top + viewport < store.size(); top += 3) {
+            for (int paint = 0; paint < 2; ++paint) {
+                for (size_t i = top; i < top + viewport; ++i) {
+                    for (int column = 0; column < 2; ++column) { chars += cell(i, column).size(); cells += 1; }
+                }
+            }
+        }
+    });
+    bench_report("cells/uncached", cells, "cells", t_plain);
+
+    auto cache = LogcatCellCache();
+    cells = 0;
+    const auto t_cached = bench_seconds([&]() {
+        for (size_t top = 0; top + viewport < store.size(); top += 3) {
+            for (int paint = 0; paint < 2; ++paint) {
+                for (size_t i = top; i < top + viewport; ++i) {
+                    for (int column = 0; column < 2; ++column) {
+                        const auto seq = store.firstSeq() + i;
+                        const auto text = cache.find(seq, column);
+                        chars += text ? text->size() : cache.insert(seq, column, cell(i, column)).size();
+                        cells += 1;
+                    }
+                }
+            }
+        }
+    });
+    bench_report("cells/cached", cells, "cells", t_cached);
+
+    std::printf("%-40s %12.1f %%  (%zu cells, %.1f KiB of text)\n", "cells/hit rate",
+                100.0 * cache.hits() / std::max<uint64_t>(1, cache.hits() + cache.misses()), cache.size(), cache.chars() * 2 / 1024.0);
+    if (chars == 0) { std::printf("no text\n"); }
+}
+
+BENCH_REGISTER("cells", run_cells_bench);
@@ -0,0 +1,201 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "pch.h"
+#include "logcatcapturefile.h"
+
+#include <cstring>
+
+#include <QDataStream>
+
+
+static const char Capture_Magic[8] = {'Q', 'L', 'O', 'G', 'C', 'A', 'P', 'T'};
+
+// Fast zlib level, captures are large and written while the user waits.
+static const int Compression_Level = 1;
+
+
+bool LogcatCaptureFile::save(const QString& path, const LogcatStore& store, const LogcatPsList_t& processes,
+                             const QStringList& devices, QString& error)
+{
+    auto file = QFile(path);
+    if (! file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        error = file.errorString();
+        return false;
+    }
+
+    auto header = Header_t();
+    std::memcpy(header.magic, Capture_Magic, sizeof(header.magic));
+    header.version = Version;
+    header.row_size = sizeof(LogcatRow_t);
+    header.block_rows = LogcatStore::Block_Rows;
+    header.row_count = store.size();
+    bool ok = file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == sizeof(header);
+
+    // rows are re-blocked from the first live row, so that every block but the last is full
+    auto index = std::vector<IndexEntry_t>();
+    auto block = LogcatBlock_t();
+    auto payload = QByteArray();
+    auto flush = [&]() {
+        const auto rows_size = block.rows.size() * sizeof(LogcatRow_t);
+        payload.resize(static_cast<int>(rows_size + block.bytes.size()));
+        std::memcpy(payload.data(), block.rows.data(), rows_size);
+        std::memcpy(payload.data() + rows_size, block.bytes.data(), block.bytes.size());
+        const auto compressed = qCompress(payload, Compression_Level);
+
+        auto entry = IndexEntry_t();
+        entry.offset = static_cast<uint64_t>(file.pos());
+        entry.size = static_cast<uint32_t>(compressed.size());
+        entry.rows = static_cast<uint32_t>(block.rows.size());
+        entry.bytes = static_cast<uint32_t>(block.bytes.size());
+        entry.reserved = 0;
+        index.push_back(entry);
+        ok = ok && file.write(compressed) == compressed.size();
+
+        block.rows.clear();
+        block.bytes.clear();
+    };
+
+    for (size_t i = 0; i < store.size() && ok; ++i) {
+        auto row = store.row(i);
+        const auto line = store.line(i);
+        row.offset = static_cast<uint32_t>(block.bytes.size());
+        block.rows.push_back(row);
+        block.bytes.insert(block.bytes.end(), line, line + row.size);
+        if (block.rows.size() == LogcatStore::Block_Rows) { flush(); }
+    }
+    if (! block.rows.empty() && ok) { flush(); }
+
+    header.block_count = static_cast<uint32_t>(index.size());
+    header.index_offset = static_cast<uint64_t>(file.pos());
+    const auto index_size = static_cast<qint64>(index.size() * sizeof(IndexEntry_t));
+    ok = ok && file.write(reinterpret_cast<const char*>(index.data()), index_size) == index_size;
+
+    auto table = QByteArray();
+    auto stream = QDataStream(&table, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_12);
+    stream << static_cast<quint32>(processes.size());
+    for (const auto& entry : processes) {
+        stream << static_cast<qint32>(entry.pid) << static_cast<qint32>(entry.ppid) << entry.user << entry.name;
+    }
+    stream << devices;
+    header.processes_offset = static_cast<uint64_t>(file.pos());
+    header.processes_size = static_cast<uint64_t>(table.size());
+    ok = ok && file.write(table) == table.size();
+
+    ok = ok && file.seek(0) && file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == sizeof(header);
+    if (! ok) {
+        error = file.errorString();
+        file.remove();
+        return false;
+    }
+    return true;
+}
+
+
+std::shared_ptr<LogcatCaptureFile> LogcatCaptureFile::open(const QString& path, QString& error)
+{
+    auto capture = std::make_shared<LogcatCaptureFile>();
+    auto& file = capture->file_;
+    file.setFileName(path);
+    if (! file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return nullptr;
+    }
+
+    const auto size = static_cast<uint64_t>(file.size());
+    capture->map_ = file.map(0, file.size());
+    if (! capture->map_) {
+        error = file.errorString();
+        return nullptr;
+    }
+
+    auto invalid = [&error](const QString& reason) {
+        error = QObject::tr("Not a qLogcat capture file: %1").arg(reason);
+        return nullptr;
+    };
+
+    auto header = Header_t();
+    if (size < sizeof(header)) { return invalid(QObject::tr("file is too short")); }
+    std::memcpy(&header, capture->map_, sizeof(header));
+    if (std::memcmp(header.magic, Capture_Magic, sizeof(header.magic)) != 0) { return invalid(QObject::tr("bad signature")); }
+    if (header.version < 1 || header.version > Version || header.row_size != sizeof(LogcatRow_t) || header.block_rows != LogcatStore::Block_Rows) {
+        return invalid(QObject::tr("unsupported version"));
+    }
+    if (header.index_offset > size || header.block_count > (size - header.index_offset) / sizeof(IndexEntry_t)
+            || header.processes_offset > size || header.processes_size > size - header.processes_offset) {
+        return invalid(QObject::tr("truncated file"));
+    }
+
+    capture->version_ = header.version;
+    capture->index_.resize(header.block_count);
+    std::memcpy(capture->index_.data(), capture->map_ + header.index_offset, header.block_count * sizeof(IndexEntry_t));
+    uint64_t rows = 0;
+    for (size_t k = 0; k < capture->index_.size(); ++k) {
+        const auto& entry = capture->index_[k];
+        const bool full = entry.rows == LogcatStore::Block_Rows;
+        if (entry.offset > size || entry.size > size - entry.offset || entry.rows == 0
+                || entry.rows > LogcatStore::Block_Rows || (! full && k + 1 != capture->index_.size())) {
+            return invalid(QObject::tr("damaged block index"));
+        }
+        rows += entry.rows;
+    }
+    if (rows != header.row_count) { return invalid(QObject::tr("damaged block index")); }
+
+    const auto table = QByteArray::fromRawData(reinterpret_cast<const char*>(capture->map_ + header.processes_offset),
+                                               static_cast<int>(header.processes_size));
+    auto stream = QDataStream(table);
+    stream.setVersion(QDataStream::Qt_5_12);
+    quint32 count = 0;
+    stream >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        qint32 pid = 0;
+        qint32 ppid = 0;
+        auto entry = LogcatPsEntry_t();
+        stream >> pid >> ppid >> entry.user >> entry.name;
+        entry.pid = pid;
+        entry.ppid = ppid;
+        capture->processes_.push_back(std::move(entry));
+    }
+    if (header.version >= 2) { stream >> capture->device_names_; }
+    if (stream.status() != QDataStream::Ok) { return invalid(QObject::tr("damaged process table")); }
+
+    return capture;
+}
+
+
+std::shared_ptr<LogcatBlock_t> LogcatCaptureFile::load(size_t k) const
+{
+    const auto& entry = index_[k];
+    auto block = std::make_shared<LogcatBlock_t>();
+    const auto data = qUncompress(map_ + entry.offset, static_cast<int>(entry.size));
+
+    const auto rows_size = entry.rows * sizeof(LogcatRow_t);
+    if (static_cast<size_t>(data.size()) != rows_size + entry.bytes) {
+        // a damaged block keeps its rows, they show up empty
+        qWarning() << "Damaged block" << k << "in" << file_.fileName();
+        block->rows.assign(entry.rows, LogcatRow_t());
+        return block;
+    }
+    block->rows.resize(entry.rows);
+    std::memcpy(block->rows.data(), data.constData(), rows_size);
+    if (version_ < 2) {
+        for (auto& row : block->rows) { row.device = 0; }
+    }
+    block->bytes.assign(data.constData() + rows_size, data.constData() + data.size());
+    return block;
+}
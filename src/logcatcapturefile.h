@@ -0,0 +1,92 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef LOGCATCAPTUREFILE_H
+#define LOGCATCAPTUREFILE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <QFile>
+#include <QString>
+#include <QStringList>
+
+#include "logcatprocessresolver.h"
+#include "logcatstore.h"
+
+
+// Binary capture file: a header, the store blocks compressed one by one, an index of the
+// blocks, the process table and the device names. The row metadata is stored in the native LogcatRow_t
+// layout next to the raw line bytes, so a block is ready to use once it is uncompressed.
+//
+// An opened file is mapped into memory and serves as a LogcatBlockSource: only the header,
+// the block index and the process table are read up front, blocks are uncompressed when
+// the store first touches them.
+class LogcatCaptureFile : public LogcatBlockSource
+{
+  public:
+    static bool save(const QString& path, const LogcatStore& store, const LogcatPsList_t& processes,
+                     const QStringList& devices, QString& error);
+    static std::shared_ptr<LogcatCaptureFile> open(const QString& path, QString& error);
+
+    const LogcatPsList_t& processes() const { return processes_; }
+    // Serials by LogcatRow_t::device, empty for files written before rows had a device.
+    const QStringList& deviceNames() const { return device_names_; }
+
+    size_t blockCount() const override { return index_.size(); }
+    size_t blockRows(size_t block) const override { return index_[block].rows; }
+    size_t blockBytes(size_t block) const override { return index_[block].bytes; }
+    std::shared_ptr<LogcatBlock_t> load(size_t block) const override;
+
+  private:
+    struct Header_t
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t row_size;          // sizeof(LogcatRow_t) of the writer
+        uint32_t block_rows;
+        uint32_t block_count;
+        uint64_t row_count;
+        uint64_t index_offset;
+        uint64_t processes_offset;
+        uint64_t processes_size;    // the process table, then the device names since version 2
+    };
+
+    struct IndexEntry_t
+    {
+        uint64_t offset;            // compressed block
+        uint32_t size;
+        uint32_t rows;
+        uint32_t bytes;             // uncompressed line bytes
+        uint32_t reserved;
+    };
+
+    // Version 1 rows have no device, the byte is padding of unknown content.
+    static const uint32_t Version = 2;
+
+  private:
+    QFile file_;
+    const uchar* map_ = nullptr;
+    uint32_t version_ = Version;
+    std::vector<IndexEntry_t> index_;
+    LogcatPsList_t processes_;
+    QStringList device_names_;
+};
+
+
+#endif // LOGCATCAPTUREFILE_H
@@ -0,0 +1,159 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef LOGCATCELLCACHE_H
+#define LOGCATCELLCACHE_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <QString>
+
+
+// Display strings of the cells painted lately, keyed by (row sequence number, column) so that
+// evicting rows from the front of the store does not invalidate them. The least recently
+// used strings are dropped once either limit is exceeded.
+class LogcatCellCache
+{
+  public:
+    static const int Max_Columns = 16;
+
+    explicit LogcatCellCache(size_t max_cells = 8192, size_t max_chars = 4 * 1024 * 1024)
+            : max_cells_(max_cells)
+            , max_chars_(max_chars)
+    {}
+
+    // Null if the cell is not cached, a hit makes it the most recently used one.
+    const QString* find(uint64_t seq, int column)
+    {
+        auto it = index_.find(key(seq, column));
+        if (it == index_.end()) {
+            misses_ += 1;
+            return nullptr;
+        }
+        hits_ += 1;
+        unlink(it->second);
+        pushFront(it->second);
+        return &entries_[it->second].text;
+    }
+
+    const QString& insert(uint64_t seq, int column, QString text)
+    {
+        const auto k = key(seq, column);
+        auto it = index_.find(k);
+        if (it != index_.end()) {
+            auto& e = entries_[it->second];
+            chars_ -= static_cast<size_t>(e.text.size());
+            e.text = std::move(text);
+            chars_ += static_cast<size_t>(e.text.size());
+            unlink(it->second);
+            pushFront(it->second);
+            return e.text;
+        }
+
+        while (! index_.empty() && (index_.size() >= max_cells_ || chars_ + static_cast<size_t>(text.size()) > max_chars_)) {
+            evictBack();
+        }
+
+        auto slot = Nil;
+        if (! free_.empty()) {
+            slot = free_.back();
+            free_.pop_back();
+        } else {
+            slot = static_cast<uint32_t>(entries_.size());
+            entries_.emplace_back();
+        }
+        auto& e = entries_[slot];
+        e.key = k;
+        e.text = std::move(text);
+        chars_ += static_cast<size_t>(e.text.size());
+        index_.emplace(k, slot);
+        pushFront(slot);
+        return e.text;
+    }
+
+    void clear()
+    {
+        entries_.clear();
+        free_.clear();
+        index_.clear();
+        head_ = tail_ = Nil;
+        chars_ = 0;
+    }
+
+    size_t size() const { return index_.size(); }
+    size_t chars() const { return chars_; }
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+
+  private:
+    static const uint32_t Nil = UINT32_MAX;
+
+    struct Entry_t
+    {
+        uint64_t key = 0;
+        QString text;
+        uint32_t prev = Nil;
+        uint32_t next = Nil;
+    };
+
+    static uint64_t key(uint64_t seq, int column) { return seq * Max_Columns + static_cast<uint64_t>(column); }
+
+    void unlink(uint32_t i)
+    {
+        auto& e = entries_[i];
+        if (e.prev != Nil) { entries_[e.prev].next = e.next; } else { head_ = e.next; }
+        if (e.next != Nil) { entries_[e.next].prev = e.prev; } else { tail_ = e.prev; }
+        e.prev = e.next = Nil;
+    }
+
+    void pushFront(uint32_t i)
+    {
+        auto& e = entries_[i];
+        e.prev = Nil;
+        e.next = head_;
+        if (head_ != Nil) { entries_[head_].prev = i; }
+        head_ = i;
+        if (tail_ == Nil) { tail_ = i; }
+    }
+
+    void evictBack()
+    {
+        const auto i = tail_;
+        unlink(i);
+        auto& e = entries_[i];
+        index_.erase(e.key);
+        chars_ -= static_cast<size_t>(e.text.size());
+        e.text = QString();
+        free_.push_back(i);
+    }
+
+  private:
+    size_t max_cells_;
+    size_t max_chars_;
+    std::vector<Entry_t> entries_;      // linked from the most to the least recently used
+    std::vector<uint32_t> free_;
+    std::unordered_map<uint64_t, uint32_t> index_;
+    uint32_t head_ = Nil;
+    uint32_t tail_ = Nil;
+    size_t chars_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+};
+
+
+#endif // LOGCATCELLCACHE_H
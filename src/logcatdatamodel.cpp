@@ -17,13 +17,17 @@
 #include "pch.h"
 #include "logcatdatamodel.h"
 #include "logcatdatamodel_def.h"
+#include "logcatcapturefile.h"
+#include "logcatparser.h"
 
-#include <regex>
+#include <algorithm>
+#include <limits>
 
 #include <QProcessEnvironment>
-#include <QMessageBox>
+#include <QRegularExpression>
 #include <QTimer>
-#include <QTextStream>
+#include <QElapsedTimer>
+#include <QHash>
 
 
 #if defined(Q_OS_WIN)
@@ -35,37 +39,174 @@ static const auto APP_SUFFIX = QStringLiteral("");
 static const auto SDK_ROOT = QStringLiteral("ANDROID_SDK_ROOT");
 
 
+// Output of a short-lived command, empty if it fails or does not finish in time.
+static QByteArray run_command(const std::tuple<QString, QStringList>& command, int msecs)
+{
+    QProcess proc;
+    proc.start(std::get<0>(command), std::get<1>(command));
+    if (! proc.waitForFinished(msecs)) {
+        proc.kill();
+        proc.waitForFinished(1000);
+        return QByteArray();
+    }
+    return proc.readAllStandardOutput();
+}
+
+
 LogcatDataModel::LogcatDataModel(QObject* parent)
         : QAbstractTableModel(parent)
+        , metrics_(std::make_shared<LogcatMetrics>())
 {
-    const auto env = QProcessEnvironment::systemEnvironment();
+    drain_timer_.setInterval(25);
+    connect(&drain_timer_, &QTimer::timeout, this, &LogcatDataModel::drainReader);
+    stats_clock_.start();
+}
+
 
-    if (! env.contains(SDK_ROOT)) {
-        QMessageBox msgBox;
-        msgBox.setText(tr("Environment variable ANDROID_SDK_ROOT is not set. Fix it and re-launch the app."));
-        msgBox.exec();
-        QTimer::singleShot(0, qApp, &QCoreApplication::quit);
+LogcatDataModel::~LogcatDataModel()
+{
+    tearDown();
+}
+
+
+void LogcatDataModel::startCapture()
+{
+    if (! devices_.empty() || devices_process_) { return; }
+
+    if (serials_ != QStringList {QStringLiteral("*")}) {
+        startDevices(serials_.isEmpty() ? QStringList {QString()} : serials_.mid(0, Max_Devices));
+        return;
+    }
+
+    // 'adb devices' may take seconds, e.g. while the server starts, the capture starts once it is done
+    const auto command = devicesCommand();
+    devices_process_ = new QProcess(this);
+    connect(devices_process_, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), this, &LogcatDataModel::onDevicesListed);
+    connect(devices_process_, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) { onDevicesListed(); }
+    });
+    QTimer::singleShot(Devices_Timeout_Msecs, devices_process_, &QProcess::kill);
+    devices_process_->start(std::get<0>(command), std::get<1>(command));
+}
+
+
+void LogcatDataModel::onDevicesListed()
+{
+    if (! devices_process_) { return; }
+    const auto output = devices_process_->exitStatus() == QProcess::NormalExit && devices_process_->error() != QProcess::FailedToStart
+            ? devices_process_->readAllStandardOutput() : QByteArray();
+    devices_process_->disconnect(this);
+    devices_process_->deleteLater();
+    devices_process_ = nullptr;
+
+    // a header line, then '<serial>\t<state>' per device
+    auto serials = QStringList();
+    for (const auto& line : QString::fromUtf8(output).split(QLatin1Char('\n'))) {
+        const auto fields = line.trimmed().split(QLatin1Char('\t'));
+        if (fields.size() == 2 && fields[1] == QStringLiteral("device")) { serials.push_back(fields[0]); }
     }
+    startDevices(serials.isEmpty() ? QStringList {QString()} : serials.mid(0, Max_Devices));
+}
+
+
+void LogcatDataModel::startDevices(const QStringList& serials)
+{
+    device_names_ = serials;
+    emit devicesChanged();
+    for (const auto& serial : serials) {
+        const auto index = static_cast<int>(devices_.size());
+        auto& device = createDevice(serial);
+        startResolver(device, index);
+
+        if (tee_config_.enabled) {
+            auto config = tee_config_;
+            config.binary = format_ == LogcatFormat_t::Binary;
+            if (! serial.isEmpty()) {
+                auto dir_name = serial;
+                dir_name.replace(QRegularExpression(QStringLiteral("[^A-Za-z0-9._-]")), QStringLiteral("_"));
+                config.directory += QStringLiteral("/") + dir_name;
+            }
+            device.tee = std::make_shared<LogcatTeeWriter>(config);
+            QMetaObject::invokeMethod(device.reader, [reader = device.reader, tee = device.tee]() { reader->setTee(tee); });
+        }
 
+        // the event tags are fetched on the reader thread, not to delay the GUI
+        const auto command = logcatCommand(serial);
+        const auto tags_command = eventTagsCommand(serial);
+        const auto decoder = createDecoder();
+        QMetaObject::invokeMethod(device.reader, [reader = device.reader, command, tags_command, decoder]() {
+            if (auto binary = dynamic_cast<LogcatBinaryDecoder*>(decoder.get())) {
+                const auto tags = run_command(tags_command, 5000);
+                binary->setEventTags(LogcatBinaryDecoder::parseEventTags(std::string_view(tags.constData(), tags.size())));
+            }
+            reader->start(std::get<0>(command), std::get<1>(command), decoder);
+        });
+        device.running.start();
+    }
     updateLogcatProcessList(QVector<int>());
 
-    connect(&logcat_proc_, &QProcess::readyReadStandardOutput,
-            this, &LogcatDataModel::onReadLogcatStdout);
-    connect(&logcat_proc_, qOverload<int, QProcess::ExitStatus>(&QProcess::finished),
-            this, &LogcatDataModel::onLogcatFinished);
+    if (devices_.size() > 1) {
+        auto inputs = std::vector<LogcatBatchQueue*>();
+        for (const auto& device : devices_) { inputs.push_back(device->reader); }
+        merger_ = new LogcatMerger(inputs);
+        merger_->moveToThread(&merger_thread_);
+        connect(&merger_thread_, &QThread::finished, merger_, &QObject::deleteLater);
+        merger_thread_.start();
+        QMetaObject::invokeMethod(merger_, &LogcatMerger::start);
+        batches_ = merger_;
+    }
+    drain_timer_.start();
+}
+
 
-    const auto [cmd, args] = logcatCommand();
-    logcat_proc_.start(cmd, args);
+LogcatDataModel::Device_t& LogcatDataModel::createDevice(const QString& serial)
+{
+    const auto index = static_cast<int>(devices_.size());
+    devices_.push_back(std::make_unique<Device_t>());
+    auto& device = *devices_.back();
+    device.serial = serial;
+
+    device.reader = new LogcatReader();
+    device.reader->setDevice(index);
+    device.reader->setMetrics(metrics_);
+    device.reader->moveToThread(&device.reader_thread);
+    connect(&device.reader_thread, &QThread::finished, device.reader, &QObject::deleteLater);
+    connect(device.reader, &LogcatReader::finished, this, [this, index](int exitCode, QProcess::ExitStatus exitStatus) {
+        onLogcatFinished(exitCode, exitStatus, index);
+    });
+    connect(device.reader, &LogcatReader::resumed, this, [this, index]() { emit reconnected(index); });
+    connect(device.reader, &LogcatReader::importProgress, this, &LogcatDataModel::importProgress);
+    connect(device.reader, &LogcatReader::importFinished, this, &LogcatDataModel::importFinished);
+    device.reader_thread.start();
+
+    device.reconnect_timer.setSingleShot(true);
+    connect(&device.reconnect_timer, &QTimer::timeout, this, [this, index]() { reconnect(index); });
+
+    if (! batches_) { batches_ = device.reader; }
+    return device;
 }
 
 
-LogcatDataModel::~LogcatDataModel()
-{}
+void LogcatDataModel::startResolver(Device_t& device, int index)
+{
+    device.resolver = new LogcatProcessResolver();
+    device.resolver->moveToThread(&device.resolver_thread);
+    connect(&device.resolver_thread, &QThread::finished, device.resolver, &QObject::deleteLater);
+    connect(device.resolver, &LogcatProcessResolver::updated, this, [this, index](LogcatPsListPtr_t list, qint64 msecs) {
+        onProcessListUpdated(list, msecs, index);
+    });
+    device.resolver_thread.start();
+
+    const auto ps_command = psCommand(device.serial);
+    QMetaObject::invokeMethod(device.resolver, [resolver = device.resolver, ps_command]() {
+        resolver->setCommand(std::get<0>(ps_command), std::get<1>(ps_command));
+    });
+}
 
 
 int LogcatDataModel::rowCount(const QModelIndex&) const
 {
-    return logcat_data_.size();
+    return static_cast<int>(logcat_data_.size());
 }
 
 
@@ -75,29 +216,105 @@ int LogcatDataModel::columnCount(const QModelIndex&) const
 }
 
 
-QString get_field(const std::string& raw_data, const LogcatField_t& f)
+static_assert(Column_Count <= LogcatCellCache::Max_Columns, "columns are packed into the cell cache keys");
+
+
+static QString to_qstring(std::string_view s)
+{
+    return QString::fromUtf8(s.data(), static_cast<int>(s.size()));
+}
+
+
+static QChar* put_digits(QChar* out, int64_t value, int width)
+{
+    for (auto p = out + width; p != out; value /= 10) { *--p = QLatin1Char(static_cast<char>('0' + value % 10)); }
+    return out + width;
+}
+
+
+// 'MM-DD' of a packed timestamp, the line itself is not touched.
+static QString date_text(LogcatTimestamp_t t)
+{
+    const auto days = t / (1000000000LL * 60 * 60 * 24);
+    QChar buf[5];
+    auto p = put_digits(buf, days / 32, 2);
+    *p++ = QLatin1Char('-');
+    put_digits(p, days % 32, 2);
+    return QString(buf, 5);
+}
+
+
+// 'HH:MM:SS.mmm', or with nanoseconds if the timestamp has them like a binary record.
+static QString time_text(LogcatTimestamp_t t)
+{
+    const auto nsec = t % 1000000000;
+    const auto secs = t / 1000000000 % (60 * 60 * 24);
+    QChar buf[18];
+    auto p = put_digits(buf, secs / 3600, 2);
+    *p++ = QLatin1Char(':');
+    p = put_digits(p, secs / 60 % 60, 2);
+    *p++ = QLatin1Char(':');
+    p = put_digits(p, secs % 60, 2);
+    *p++ = QLatin1Char('.');
+    p = nsec % 1000000 == 0 ? put_digits(p, nsec / 1000000, 3) : put_digits(p, nsec, 9);
+    return QString(buf, static_cast<int>(p - buf));
+}
+
+
+QString LogcatDataModel::cellText(size_t i, int column) const
 {
-    auto res = QString(raw_data.substr(f[0], f[1]).c_str());
-    //qDebug() << "  data: " << raw_data.c_str() << "\n  chars [" << f[0] << "," << f[1] << "]:" << res;
-    return res;
+    const auto& row = logcat_data_.row(i);
+    switch (column) {
+    case DATE_Column: return date_text(row.timestamp);
+    case TIME_Column: return time_text(row.timestamp);
+    case TID_Column: return QString::number(row.tid);
+    case TAG_Column: return to_qstring(logcat_data_.tag(i));
+    case MESSAGE_Column: return to_qstring(logcat_data_.message(i));
+    }
+    return QString();
 }
 
 
 QVariant LogcatDataModel::data(const QModelIndex& index, int role) const
 {
+    // one shared string per priority letter
+    static const auto priorities = []() {
+        auto texts = std::vector<QString>();
+        for (int p = 0; p <= static_cast<int>(LogcatPriority_t::Silent); ++p) {
+            texts.push_back(QString(QLatin1Char(priority_to_char(static_cast<LogcatPriority_t>(p)))));
+        }
+        return texts;
+    }();
+
     if (role == Qt::DisplayRole) {
-        //qDebug() << "Getting row" << index.row();
-        const auto& rec = logcat_data_.at(index.row());
+        const auto i = static_cast<size_t>(index.row());
+        const auto& row = logcat_data_.row(i);
         switch (index.column()) {
-        case DATE_Column: return get_field(rec.raw_data, rec.date);
-        case TIME_Column: return get_field(rec.raw_data, rec.time);
-        case PID_Column: return get_field(rec.raw_data, rec.pid);
-        case TID_Column: return get_field(rec.raw_data, rec.tid);
-        case PPID_Column: return findProcessPPID(get_field(rec.raw_data, rec.pid));
-        case NAME_Column: return findProcessName(get_field(rec.raw_data, rec.pid));
-        case PRIORITY_Column: return get_field(rec.raw_data, rec.priority);
-        case TAG_Column: return get_field(rec.raw_data, rec.tag);
-        case MESSAGE_Column: return get_field(rec.raw_data, rec.message);
+        case DATE_Column:
+        case TIME_Column:
+        case TID_Column:
+        case TAG_Column:
+        case MESSAGE_Column: {
+            // the view asks for the same cells again on every repaint and scroll step
+            const auto seq = logcat_data_.firstSeq() + i;
+            if (const auto text = cell_cache_.find(seq, index.column())) { return *text; }
+            auto timer = QElapsedTimer();
+            timer.start();
+            auto text = cellText(i, index.column());
+            metrics_->cell_ns.record(static_cast<uint64_t>(timer.nsecsElapsed()));
+            return cell_cache_.insert(seq, index.column(), std::move(text));
+        }
+        case PID_Column: {
+            const auto proc = findProcess(process_key(row));
+            return proc ? proc->pid_text : QString::number(row.pid);
+        }
+        case PPID_Column: return findProcessPPID(process_key(row));
+        case NAME_Column: return findProcessName(process_key(row));
+        case PRIORITY_Column: {
+            if (row.priority == LogcatPriority_t::Unknown) { return to_qstring(logcat_data_.priority(i)); }
+            return priorities[static_cast<size_t>(row.priority)];
+        }
+        case DEVICE_Column: return device_names_.value(row.device);
         }
         return QStringLiteral("???");
     }
@@ -118,150 +335,579 @@ QVariant LogcatDataModel::headerData(int section, Qt::Orientation orientation, i
         case PRIORITY_Column: return tr("Priority");
         case TAG_Column: return tr("Tag");
         case MESSAGE_Column: return tr("Message");
+        case DEVICE_Column: return tr("Device");
         }
     }
     return QVariant();
 }
 
 
-void LogcatDataModel::onReadLogcatStdout()
+void LogcatDataModel::setIngestBudget(int max_rows, int max_msecs)
 {
-    static int counter = 0;
-    static const auto re = std::regex(R"(^(\d+-\d+)\s+(\d+:\d+:\d+\.\d+)\s+(\d+)\s+(\d+)\s+(\w+)\s+([^:]+?)\s*:\s(.+)$)");
+    ingest_max_rows_ = std::max(1, max_rows);
+    ingest_max_msecs_ = std::max(1, max_msecs);
+}
 
-    auto unknown_pids = QVector<int>();
 
-    logcat_proc_.setReadChannel(QProcess::StandardOutput);
-    auto stream = QTextStream(&logcat_proc_);
-    while (! stream.atEnd()) {
-        std::smatch match;
-        auto line = stream.readLine().toStdString();
-        if (std::regex_match(line, match, re)) {
-            beginInsertRows(index(rowCount(), 0), rowCount(), rowCount());
-            auto rec = LogcatRecord_t {
-                line,
-                {match.position(1), match.length(1)},
-                {match.position(2), match.length(2)},
-                {match.position(3), match.length(3)},
-                {match.position(4), match.length(4)},
-                {match.position(5), match.length(5)},
-                {match.position(6), match.length(6)},
-                {match.position(7), match.length(7)}
-            };
-            logcat_data_.emplace(counter, rec);
-            counter += 1;
-            int pid = std::stoi(match.str(3));
-            auto it = logcat_proc_list_.find(pid);
-            if (it == logcat_proc_list_.end()) { unknown_pids.push_back(pid); }
-            endInsertRows();
+void LogcatDataModel::setRetention(const LogcatRetention_t& retention)
+{
+    retention_ = retention;
+    applyRetention();
+}
+
+
+void LogcatDataModel::applyRetention()
+{
+    const auto count = logcat_data_.overRetention(retention_);
+    if (count == 0) { return; }
+
+    beginRemoveRows(QModelIndex(), 0, static_cast<int>(count) - 1);
+    logcat_data_.evictFront(count);
+    message_index_.evictBefore(logcat_data_.firstSeq());
+    tag_index_.evictBefore(logcat_data_.firstSeq());
+    endRemoveRows();
+
+    for (auto it = pid_rows_.begin(); it != pid_rows_.end();) {
+        auto& rows = it->second;
+        rows.erase(rows.begin(), std::lower_bound(rows.begin(), rows.end(), logcat_data_.firstSeq()));
+        if (rows.empty()) {
+            it = pid_rows_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+
+LogcatStatsEntry_t LogcatDataModel::streamTotals(int window_secs) const
+{
+    return stream_stats_.total(stats_clock_.elapsed(), window_secs);
+}
+
+
+std::vector<LogcatStatsRow_t> LogcatDataModel::streamStats(LogcatStatsKind_t kind, int window_secs, size_t k) const
+{
+    static const QString priorities[] = {
+        QStringLiteral("?"), QStringLiteral("V"), QStringLiteral("D"), QStringLiteral("I"),
+        QStringLiteral("W"), QStringLiteral("E"), QStringLiteral("F"), QStringLiteral("S")
+    };
+
+    // processes are merged by name, several PIDs of one app add up, so the summaries are read whole
+    const auto now = stats_clock_.elapsed();
+    const auto process = kind == LogcatStatsKind_t::Process;
+    auto entries = stream_stats_.top(kind, now, window_secs, process ? std::numeric_limits<size_t>::max() : k);
+    auto rows = std::vector<LogcatStatsRow_t>();
+    auto by_name = QHash<QString, size_t>();
+    for (const auto& e : entries) {
+        auto name = QString();
+        switch (kind) {
+        case LogcatStatsKind_t::Tag: name = QString::fromStdString(tag_index_.tagName(static_cast<uint32_t>(e.key))); break;
+        case LogcatStatsKind_t::Process: name = findProcessName(static_cast<int>(e.key)); break;
+        case LogcatStatsKind_t::Priority: name = priorities[e.key < 8 ? e.key : 0]; break;
+        }
+        if (process && name.isEmpty()) { name = QStringLiteral("pid %1").arg(process_key_pid(static_cast<int>(e.key))); }
+
+        auto it = process ? by_name.find(name) : by_name.end();
+        if (it == by_name.end()) {
+            if (process) { by_name.insert(name, rows.size()); }
+            rows.push_back({name, e.lines_per_sec, e.bytes_per_sec, e.error_per_sec});
+        } else {
+            auto& row = rows[it.value()];
+            row.lines_per_sec += e.lines_per_sec;
+            row.bytes_per_sec += e.bytes_per_sec;
+            row.error_per_sec += e.error_per_sec;
+        }
+    }
+
+    std::sort(rows.begin(), rows.end(),
+              [](const LogcatStatsRow_t& a, const LogcatStatsRow_t& b) { return a.lines_per_sec > b.lines_per_sec; });
+    if (rows.size() > k) { rows.resize(k); }
+    return rows;
+}
+
+
+const LogcatTagIndex& LogcatDataModel::tagIndex() const
+{
+    // appended rows are indexed as they come, only the rows of a capture are left
+    const auto first = logcat_data_.firstSeq();
+    for (auto seq = std::max(tag_index_.endSeq(), first); seq < logcat_data_.endSeq(); ++seq) {
+        tag_index_.append(seq, logcat_data_.tag(seq - first), logcat_data_.row(seq - first).priority);
+    }
+    return tag_index_;
+}
+
+
+const LogcatTimeIndex& LogcatDataModel::timeIndex() const
+{
+    const auto first = logcat_data_.firstSeq();
+    if (time_index_.endSeq() < first) { time_index_.clear(); }
+    time_index_.evictBefore(first);
+    for (auto seq = std::max(time_index_.endSeq(), first); seq < logcat_data_.endSeq(); ++seq) {
+        time_index_.append(seq, logcat_data_.row(seq - first).timestamp);
+    }
+    return time_index_;
+}
+
+
+int LogcatDataModel::findTimeRow(LogcatTimestamp_t t) const
+{
+    const auto first = logcat_data_.firstSeq();
+    const auto end = logcat_data_.endSeq();
+    // rows before the block the index finds are all earlier than `t`
+    for (auto seq = std::max(timeIndex().range(t, std::numeric_limits<LogcatTimestamp_t>::max()).first, first);
+         seq < end; ++seq) {
+        if (logcat_data_.row(seq - first).timestamp >= t) { return static_cast<int>(seq - first); }
+    }
+    return static_cast<int>(logcat_data_.size());
+}
+
+
+LogcatIngestStats_t LogcatDataModel::ingestStats() const
+{
+    auto total = LogcatIngestStats_t();
+    for (const auto& device : devices_) {
+        const auto s = device->reader->stats();
+        total.queue_depth += s.queue_depth;
+        total.queue_capacity += s.queue_capacity;
+        total.batches += s.batches;
+        total.rows += s.rows;
+        total.bytes += s.bytes;
+        total.backpressured += s.backpressured;
+        total.dropped_batches += s.dropped_batches;
+        total.dropped_rows += s.dropped_rows;
+        total.malformed += s.malformed;
+        total.reconnects += s.reconnects;
+        total.duplicates += s.duplicates;
+    }
+    return total;
+}
+
+
+LogcatMetricList_t LogcatDataModel::metricsReport(LogcatReportBase_t& base) const
+{
+    auto report = LogcatMetricList_t();
+    auto counter = [&report](const char* name, const char* unit, double value) {
+        auto m = LogcatMetric_t();
+        m.name = name;
+        m.unit = unit;
+        m.value = value;
+        report.push_back(std::move(m));
+    };
+    auto histogram = [&report](const char* name, const char* unit, const LogcatHistogram& h) {
+        auto m = LogcatMetric_t();
+        m.name = name;
+        m.unit = unit;
+        m.is_histogram = true;
+        m.histogram = h.snapshot();
+        report.push_back(std::move(m));
+    };
+
+    const auto ingest = ingestStats();
+    const auto secs = base.timer.isValid() ? static_cast<double>(base.timer.nsecsElapsed()) / 1e9 : 0.0;
+    if (base.teardowns != teardowns_) {
+        base.rows = 0;
+        base.bytes = 0;
+        base.teardowns = teardowns_;
+    }
+    const auto new_rows = ingest.rows - std::min(base.rows, ingest.rows);
+    const auto new_bytes = ingest.bytes - std::min(base.bytes, ingest.bytes);
+    counter("ingest.lines_per_sec", "rows/s", secs > 0 ? new_rows / secs : 0.0);
+    counter("ingest.bytes_per_sec", "bytes/s", secs > 0 ? new_bytes / secs : 0.0);
+    base.timer.start();
+    base.rows = ingest.rows;
+    base.bytes = ingest.bytes;
+
+    counter("ingest.rows", "rows", static_cast<double>(ingest.rows));
+    counter("ingest.bytes", "bytes", static_cast<double>(ingest.bytes));
+    counter("ingest.queue_depth", "batches", static_cast<double>(ingest.queue_depth));
+    counter("ingest.backpressured", "batches", static_cast<double>(ingest.backpressured));
+    counter("ingest.dropped_rows", "rows", static_cast<double>(ingest.dropped_rows));
+    counter("ingest.malformed", "records", static_cast<double>(ingest.malformed));
+    counter("ingest.reconnects", "reconnects", static_cast<double>(ingest.reconnects));
+    counter("ingest.duplicates", "rows", static_cast<double>(ingest.duplicates));
+    histogram("read.bytes", "bytes", metrics_->read_bytes);
+    histogram("parse.ns_per_line", "ns", metrics_->parse_ns_per_line);
+    histogram("insert.rows", "rows", metrics_->insert_rows);
+    histogram("insert.ns", "ns", metrics_->insert_ns);
+    histogram("filter.ns", "ns", metrics_->filter_ns);
+    histogram("ps.msecs", "ms", metrics_->ps_msecs);
+
+    const auto rows = logcat_data_.size();
+    counter("store.rows", "rows", static_cast<double>(rows));
+    counter("store.bytes", "bytes", static_cast<double>(logcat_data_.memoryUsage()));
+    counter("store.bytes_per_row", "bytes", rows > 0 ? static_cast<double>(logcat_data_.memoryUsage()) / rows : 0.0);
+    counter("index.bytes", "bytes", static_cast<double>(message_index_.memoryUsage()));
+    counter("time_index.bytes", "bytes", static_cast<double>(time_index_.memoryUsage()));
+    counter("tag_index.bytes", "bytes", static_cast<double>(tag_index_.memoryUsage()));
+    counter("tag_index.tags", "tags", static_cast<double>(tag_index_.tagCount()));
+
+    counter("view.cache_hits", "cells", static_cast<double>(cell_cache_.hits()));
+    counter("view.cache_misses", "cells", static_cast<double>(cell_cache_.misses()));
+    counter("view.cache_chars", "chars", static_cast<double>(cell_cache_.chars()));
+    histogram("view.cell_ns", "ns", metrics_->cell_ns);
+
+    if (isTeeActive()) {
+        const auto tee = teeStats();
+        counter("tee.bytes_written", "bytes", static_cast<double>(tee.bytes_written));
+        counter("tee.stalls", "writes", static_cast<double>(tee.stalls));
+        counter("tee.dropped_bytes", "bytes", static_cast<double>(tee.dropped_bytes));
+    }
+    return report;
+}
+
+
+bool LogcatDataModel::isTeeActive() const
+{
+    return std::any_of(devices_.begin(), devices_.end(), [](const auto& device) { return device->tee != nullptr; });
+}
+
+
+LogcatTeeStats_t LogcatDataModel::teeStats() const
+{
+    auto total = LogcatTeeStats_t();
+    for (const auto& device : devices_) {
+        if (! device->tee) { continue; }
+        const auto s = device->tee->stats();
+        total.queue_depth += s.queue_depth;
+        total.queue_capacity += s.queue_capacity;
+        total.bytes_in += s.bytes_in;
+        total.bytes_written += s.bytes_written;
+        total.files += s.files;
+        total.stalls += s.stalls;
+        total.dropped_bytes += s.dropped_bytes;
+        total.write_errors += s.write_errors;
+    }
+    return total;
+}
+
+
+QString LogcatDataModel::teeFile() const
+{
+    auto files = QStringList();
+    for (const auto& device : devices_) {
+        if (device->tee) { files.push_back(device->tee->currentFile()); }
+    }
+    return files.join(QLatin1Char('\n'));
+}
+
+
+void LogcatDataModel::drainReader()
+{
+    drain_scheduled_ = false;
+    if (! batches_) { return; }
+
+    auto timer = QElapsedTimer();
+    timer.start();
+
+    auto batches = std::vector<LogcatBatchQueue::Batch_t>();
+    auto batch = LogcatBatchQueue::Batch_t();
+    int rows = 0;
+    bool more = false;
+    while (batches_->pop(batch)) {
+        rows += static_cast<int>(batch->rows.size());
+        batches.push_back(std::move(batch));
+        if (rows >= ingest_max_rows_ || timer.elapsed() >= ingest_max_msecs_) {
+            more = true;  // leave the rest to the next turns, to process other events in the app queue
+            break;
         }
-        if (0 == counter % 10) {
-            break;  // to process other events in the app queue
+    }
+    if (rows == 0) { return; }
+
+    auto unknown_pids = QVector<int>();
+    auto seq = logcat_data_.endSeq();
+    auto pid_it = pid_rows_.end();
+    int last_key = -1;
+    for (const auto& b : batches) {
+        for (const auto& row : b->rows) {
+            const auto key = process_key(row);
+            if (key != last_key) {
+                last_key = key;
+                pid_it = pid_rows_.try_emplace(key).first;
+                if (logcat_proc_list_.find(key) == logcat_proc_list_.end()
+                    && requested_pids_.insert(key).second) {
+                    unknown_pids.push_back(key);
+                }
+            }
+            pid_it->second.push_back(seq);
+            seq += 1;
         }
     }
 
+    const int first = rowCount();
+    beginInsertRows(QModelIndex(), first, first + rows - 1);
+    for (const auto& b : batches) {
+        logcat_data_.append(*b);
+    }
+    const auto now = stats_clock_.elapsed();
+    for (auto i = static_cast<size_t>(first); i < logcat_data_.size(); ++i) {
+        const auto& row = logcat_data_.row(i);
+        message_index_.append(logcat_data_.firstSeq() + i, logcat_data_.message(i));
+        const auto tag = tag_index_.append(logcat_data_.firstSeq() + i, logcat_data_.tag(i), row.priority);
+        stream_stats_.add(now, tag, static_cast<uint64_t>(process_key(row)), row.priority, row.size);
+    }
+    endInsertRows();
+
+    for (auto& b : batches) {
+        batches_->recycle(std::move(b));
+    }
+
+    applyRetention();
+
     if (unknown_pids.size() > 0) {
         updateLogcatProcessList(unknown_pids);
     }
+    metrics_->insert_rows.record(static_cast<uint64_t>(rows));
+    metrics_->insert_ns.record(static_cast<uint64_t>(timer.nsecsElapsed()));
+
+    if (more && ! drain_scheduled_) {
+        drain_scheduled_ = true;
+        QTimer::singleShot(0, this, &LogcatDataModel::drainReader);
+    }
+}
+
+
+bool LogcatDataModel::saveCapture(const QString& path, QString& error) const
+{
+    auto processes = LogcatPsList_t();
+    processes.reserve(logcat_proc_list_.size());
+    for (const auto& [pid, info] : logcat_proc_list_) {
+        processes.push_back({pid, info.ppid, proc_strings_.at(info.user_id), proc_strings_.at(info.name_id)});
+    }
+    return LogcatCaptureFile::save(path, logcat_data_, processes, device_names_, error);
+}
+
+
+bool LogcatDataModel::openCapture(const QString& path, QString& error)
+{
+    auto capture = LogcatCaptureFile::open(path, error);
+    if (! capture) { return false; }
+
+    tearDown();
+
+    // rows of a capture are not tracked per PID, so the process table, which is final, is
+    // filled without signals; it has to be in place when the reset has the view filtered anew
+    beginResetModel();
+    logcat_data_.assign(capture);
+    cell_cache_.clear();
+    message_index_.clear();
+    tag_index_.clear();
+    stream_stats_.clear();
+    time_index_.clear();
+    pid_rows_.clear();
+    requested_pids_.clear();
+    logcat_proc_list_.clear();
+    onProcessListUpdated(std::make_shared<const LogcatPsList_t>(capture->processes()), 0);
+    device_names_ = capture->deviceNames();
+    endResetModel();
+    emit devicesChanged();
+    return true;
 }
 
 
-void LogcatDataModel::onLogcatFinished(int exitCode, QProcess::ExitStatus exitStatus)
+void LogcatDataModel::importLogFile(const QString& path)
 {
-    Q_UNUSED(exitCode);
-    Q_UNUSED(exitStatus);
-    // TODO: handle reconnect
+    tearDown();
+
+    // there is no device to ask, rows of a dump keep empty process columns
+    beginResetModel();
+    logcat_data_.clear();
+    message_index_.clear();
+    tag_index_.clear();
+    stream_stats_.clear();
+    cell_cache_.clear();
+    time_index_.clear();
+    pid_rows_.clear();
+    requested_pids_.clear();
+    logcat_proc_list_.clear();
+    device_names_.clear();
+    endResetModel();
+    emit devicesChanged();
+
+    const auto reader = createDevice(QString()).reader;
+    QMetaObject::invokeMethod(reader, [reader, path]() { reader->importFile(path); });
+    drain_timer_.start();
+}
+
+
+void LogcatDataModel::onLogcatFinished(int exitCode, QProcess::ExitStatus exitStatus, int device)
+{
+    if (! reconnect_ || device < 0 || device >= static_cast<int>(devices_.size())) { return; }
+
+    auto& d = *devices_[device];
+    if (d.running.isValid() && d.running.elapsed() >= Reconnect_Stable_Msecs) { d.reconnect_attempts = 0; }
+    d.exit_code = exitStatus == QProcess::NormalExit ? exitCode : -1;
+
+    const auto shift = std::min(d.reconnect_attempts, 16);
+    const auto msecs = static_cast<int>(std::min<qint64>(reconnect_max_msecs_, qint64(Reconnect_Min_Msecs) << shift));
+    d.reconnect_attempts += 1;
+    d.reconnect_timer.start(msecs);
+    emit reconnecting(device, d.exit_code, d.reconnect_attempts, msecs);
+}
+
+
+void LogcatDataModel::reconnect(int index)
+{
+    auto& device = *devices_[index];
+    const auto command = logcatCommand(device.serial);
+    const auto reason = tr("logcat exited with code %1, reconnect attempt %2").arg(device.exit_code).arg(device.reconnect_attempts);
+    QMetaObject::invokeMethod(device.reader, [reader = device.reader, command, reason]() {
+        reader->resume(std::get<0>(command), std::get<1>(command), reason);
+    });
+    device.running.start();
 }
 
 
 void LogcatDataModel::tearDown()
 {
-    logcat_proc_.kill();
+    drain_timer_.stop();
+    batches_ = nullptr;
+    teardowns_ += 1;
+
+    // a capture still waiting for the device list is not started
+    if (devices_process_) {
+        devices_process_->disconnect(this);
+        delete devices_process_;
+        devices_process_ = nullptr;
+    }
+
+    // the merger reads from the readers, it goes first
+    if (merger_) {
+        QMetaObject::invokeMethod(merger_, &LogcatMerger::stop, Qt::BlockingQueuedConnection);
+        merger_thread_.quit();
+        merger_thread_.wait();
+        merger_ = nullptr;
+    }
+    for (auto& device : devices_) {
+        device->reconnect_timer.stop();
+        QMetaObject::invokeMethod(device->reader, &LogcatReader::stop, Qt::BlockingQueuedConnection);
+        device->reader_thread.quit();
+        device->reader_thread.wait();
+        device->tee.reset();
+        if (device->resolver) {
+            QMetaObject::invokeMethod(device->resolver, &LogcatProcessResolver::stop, Qt::BlockingQueuedConnection);
+            device->resolver_thread.quit();
+            device->resolver_thread.wait();
+        }
+    }
+    devices_.clear();
 }
 
 
-std::tuple<QString, QStringList> LogcatDataModel::logcatCommand() const
+static std::tuple<QString, QStringList> adb_command(const QString& serial, const QStringList& args)
 {
     return {
         QString("%1/platform-tools/adb%2").arg(QProcessEnvironment::systemEnvironment().value(SDK_ROOT), APP_SUFFIX),
-        {QStringLiteral("shell"), QStringLiteral("logcat"), QStringLiteral("-b"), QStringLiteral("main,system,crash,events")}
+        serial.isEmpty() ? args : QStringList {QStringLiteral("-s"), serial} + args
     };
 }
 
 
-std::tuple<QString, QStringList> LogcatDataModel::psCommand() const
+std::tuple<QString, QStringList> LogcatDataModel::logcatCommand(const QString& serial) const
 {
-    return {
-        QString("%1/platform-tools/adb%2").arg(QProcessEnvironment::systemEnvironment().value(SDK_ROOT), APP_SUFFIX),
-        {QStringLiteral("shell"), QStringLiteral("ps"), QStringLiteral("-o"), QStringLiteral("USER,PID,PPID,NAME")}
-    };
+    // exec-out keeps the binary stream intact, 'shell' may translate line endings
+    auto args = format_ == LogcatFormat_t::Binary
+            ? QStringList {QStringLiteral("exec-out"), QStringLiteral("logcat"), QStringLiteral("-B")}
+            : QStringList {QStringLiteral("shell"), QStringLiteral("logcat")};
+    args << QStringLiteral("-b") << QStringLiteral("main,system,crash,events");
+    return adb_command(serial, args);
+}
+
+
+std::tuple<QString, QStringList> LogcatDataModel::psCommand(const QString& serial) const
+{
+    return adb_command(serial, {QStringLiteral("shell"), QStringLiteral("ps"), QStringLiteral("-o"), QStringLiteral("USER,PID,PPID,NAME")});
+}
+
+
+std::tuple<QString, QStringList> LogcatDataModel::eventTagsCommand(const QString& serial) const
+{
+    return adb_command(serial, {QStringLiteral("exec-out"), QStringLiteral("cat"), QStringLiteral("/system/etc/event-log-tags")});
+}
+
+
+std::tuple<QString, QStringList> LogcatDataModel::devicesCommand() const
+{
+    return adb_command(QString(), {QStringLiteral("devices")});
+}
+
+
+std::shared_ptr<LogcatDecoder> LogcatDataModel::createDecoder() const
+{
+    return make_decoder(format_);
 }
 
 
 void LogcatDataModel::updateLogcatProcessList(const QVector<int>& pids)
 {
-    const auto [cmd, args] = psCommand();
-    QProcess ps;
-    ps.start(cmd, args);
-    if (!ps.waitForStarted()) { return; }
-    ps.waitForFinished();
-
-    static const auto re = std::regex(R"(^(\S+)\s+(\d+)\s+(\d+)\s+(.+)$)");
-
-    auto parse_data = [](auto&& line, const auto& re) -> std::tuple<LogcatProcessInfo_t, std::smatch> {
-        std::smatch match;
-        if (std::regex_match(line, match, re)) {
-            auto rec = LogcatProcessInfo_t {
-                std::move(line),
-                {match.position(1), match.length(1)},
-                {match.position(2), match.length(2)},
-                {match.position(3), match.length(3)},
-                {match.position(4), match.length(4)}
-            };
-            return { std::move(rec), std::move(match) };
-        }
-        return { {}, std::move(match) };
-    };
+    auto device_pids = std::vector<QVector<int>>(devices_.size());
+    for (auto key : pids) {
+        const auto index = static_cast<size_t>(process_key_device(key));
+        if (index < device_pids.size()) { device_pids[index].push_back(process_key_pid(key)); }
+    }
+    for (size_t i = 0; i < devices_.size(); ++i) {
+        const auto resolver = devices_[i]->resolver;
+        if (! resolver || (device_pids[i].isEmpty() && ! pids.isEmpty())) { continue; }
+        QMetaObject::invokeMethod(resolver, [resolver, pids = device_pids[i]]() { resolver->request(pids); });
+    }
+}
+
+
+void LogcatDataModel::onProcessListUpdated(LogcatPsListPtr_t list, qint64 msecs, int device)
+{
+    last_ps_msecs_ = msecs;
+    if (! devices_.empty()) { metrics_->ps_msecs.record(static_cast<uint64_t>(std::max<qint64>(0, msecs))); }
+
+    auto changed = std::vector<int>();
+    for (const auto& entry : *list) {
+        const auto key = process_key(device, entry.pid);
+        requested_pids_.erase(key);
+
+        auto info = LogcatProcessInfo_t();
+        info.ppid = entry.ppid;
+        info.user_id = proc_strings_.intern(entry.user);
+        info.name_id = proc_strings_.intern(entry.name);
 
-    ps.setReadChannel(QProcess::StandardOutput);
-    auto stream = QTextStream(&ps);
-    while (! stream.atEnd()) {
-        auto [rec, match] = parse_data(stream.readLine().toStdString(), re);
-        if (rec.raw_data.size() <= 0) { continue; }
-        auto pid = std::stoi(match.str(2));
-        auto it = logcat_proc_list_.find(pid);
+        auto it = logcat_proc_list_.find(key);
         if (it == logcat_proc_list_.end()) {
-            logcat_proc_list_.emplace(pid, rec);
+            info.pid_text = QString::number(process_key_pid(key));
+            info.ppid_text = QString::number(entry.ppid);
+            logcat_proc_list_.emplace(key, std::move(info));
+        } else if (it->second.ppid != info.ppid || it->second.name_id != info.name_id) {
+            info.pid_text = it->second.pid_text;
+            info.ppid_text = QString::number(entry.ppid);
+            it->second = std::move(info);
         } else {
-            it->second = rec;
+            continue;
         }
+        if (pid_rows_.find(key) != pid_rows_.end()) { changed.push_back(key); }
     }
 
-    for (auto pid: pids) {
-        auto it = logcat_proc_list_.find(pid);
-        if (it == logcat_proc_list_.end()) {
-            auto [rec, match] = parse_data(QString("unknown %2 0 unknown").arg(pid).toStdString(), re);
-            logcat_proc_list_.emplace(pid, rec);
-        }
+    if (changed.empty() || logcat_data_.empty()) { return; }
+    emit processInfoChanged(changed);
+
+    const auto first_seq = logcat_data_.firstSeq();
+    if (changed.size() > 64) {
+        emit dataChanged(index(0, PPID_Column), index(rowCount() - 1, NAME_Column), {Qt::DisplayRole});
+        return;
+    }
+    for (auto pid : changed) {
+        const auto& rows = pid_rows_.at(pid);
+        const auto top = static_cast<int>(rows.front() - first_seq);
+        const auto bottom = static_cast<int>(rows.back() - first_seq);
+        emit dataChanged(index(top, PPID_Column), index(bottom, NAME_Column), {Qt::DisplayRole});
     }
 }
 
 
-QString LogcatDataModel::findProcessName(const QString& pid) const
+QString LogcatDataModel::findProcessName(int pid) const
 {
-    auto it = logcat_proc_list_.find(pid.toInt());
-    if (it != logcat_proc_list_.end()) {
-        return get_field(it->second.raw_data, it->second.name);
-    }
-    return QStringLiteral("");
+    const auto proc = findProcess(pid);
+    return proc ? proc_strings_.at(proc->name_id) : QString();
 }
 
 
-QString LogcatDataModel::findProcessPPID(const QString& pid) const
+QString LogcatDataModel::findProcessPPID(int pid) const
 {
-    auto it = logcat_proc_list_.find(pid.toInt());
-    if (it != logcat_proc_list_.end()) {
-        return get_field(it->second.raw_data, it->second.ppid);
-    }
-    return QStringLiteral("");
+    const auto proc = findProcess(pid);
+    return proc ? proc->ppid_text : QString();
 }
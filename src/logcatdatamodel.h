@@ -17,48 +17,62 @@
 #ifndef LOGCATDATAMODEL_H
 #define LOGCATDATAMODEL_H
 
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <tuple>
+#include <utility>
+#include <vector>
 
 #include <QAbstractTableModel>
+#include <QElapsedTimer>
 #include <QProcess>
-
-
-using LogcatField_t = ptrdiff_t[2];
-
-
-struct LogcatRecord_t
-{
-    std::string raw_data;
-    LogcatField_t date;
-    LogcatField_t time;
-    LogcatField_t pid;
-    LogcatField_t tid;
-    LogcatField_t priority;
-    LogcatField_t tag;
-    LogcatField_t message;
-};
-
-using LogcatData_t = std::unordered_map<int, LogcatRecord_t>;
-
-
-struct LogcatProcessInfo_t
+#include <QThread>
+#include <QTimer>
+
+#include "logcatcellcache.h"
+#include "logcatdatamodel_def.h"
+#include "logcatdecoder.h"
+#include "logcatmerger.h"
+#include "logcatmessageindex.h"
+#include "logcatmetrics.h"
+#include "logcatprocessresolver.h"
+#include "logcatreader.h"
+#include "logcatstore.h"
+#include "logcatstreamstats.h"
+#include "logcatstringtable.h"
+#include "logcattagindex.h"
+#include "logcatteewriter.h"
+#include "logcattimeindex.h"
+
+
+using LogcatData_t = LogcatStore;
+
+// Sequence numbers of the rows logged by a process in ascending order, by process_key().
+using LogcatPidRows_t = std::unordered_map<int, std::deque<uint64_t>>;
+
+// Ingest totals at the previous metrics report, each consumer of reports keeps its own.
+struct LogcatReportBase_t
 {
-    std::string raw_data;
-    LogcatField_t user;
-    LogcatField_t pid;
-    LogcatField_t ppid;
-    LogcatField_t name;
+    QElapsedTimer timer;
+    uint64_t rows = 0;
+    uint64_t bytes = 0;
+    uint64_t teardowns = 0;
 };
 
-using LogcatProcessList_t = std::unordered_map<int, LogcatProcessInfo_t>;
-
 
 class LogcatDataModel : public QAbstractTableModel
 {
     Q_OBJECT
 
   public:
+    static const int Reconnect_Min_Msecs = 500;
+    static const int Reconnect_Stable_Msecs = 10000;  // a logcat running this long resets the backoff
+    static const int Devices_Timeout_Msecs = 5000;
+
     LogcatDataModel(QObject *parent);
     virtual ~LogcatDataModel();
 
@@ -67,22 +81,166 @@ class LogcatDataModel : public QAbstractTableModel
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
 
+    // Limits how many rows / how much time a single event-loop turn may spend on ingestion,
+    // the rest of the parsed data is committed in the next turns.
+    void setIngestBudget(int max_rows, int max_msecs);
+    int ingestMaxRows() const { return ingest_max_rows_; }
+    int ingestMaxMsecs() const { return ingest_max_msecs_; }
+
+    // Old rows are evicted from the front once any of the limits is exceeded.
+    void setRetention(const LogcatRetention_t& retention);
+    const LogcatRetention_t& retention() const { return retention_; }
+
+    const LogcatData_t& store() const { return logcat_data_; }
+    const LogcatMessageIndex& messageIndex() const { return message_index_; }
+    void setMessageIndexLimit(size_t bytes) { message_index_.setMemoryLimit(bytes); }
+    // Rows of an opened capture are indexed on first access.
+    const LogcatTagIndex& tagIndex() const;
+    // Brought up to date with the store on access.
+    const LogcatTimeIndex& timeIndex() const;
+    // The first row at or after `t` in store order, rowCount() if there is none.
+    int findTimeRow(LogcatTimestamp_t t) const;
+    size_t memoryUsage() const { return logcat_data_.memoryUsage(); }
+    LogcatIngestStats_t ingestStats() const;
+    // Stage distributions shared with the readers and the filter proxy.
+    const std::shared_ptr<LogcatMetrics>& metrics() const { return metrics_; }
+    // Counters, gauges and distributions of all stages, rates are since the previous report
+    // made with `base`.
+    LogcatMetricList_t metricsReport(LogcatReportBase_t& base) const;
+    // Rates of the rows ingested over the last `window_secs`, up to LogcatStreamStats::Max_Window_Secs.
+    LogcatStatsEntry_t streamTotals(int window_secs) const;
+    // The `k` heaviest tags, process names or priorities by lines over the last `window_secs`.
+    std::vector<LogcatStatsRow_t> streamStats(LogcatStatsKind_t kind, int window_secs, size_t k) const;
+
+    // Serials of the devices to capture, each one gets its own reader and process resolver
+    // thread and the rows are merged by timestamp. An empty list captures the only attached
+    // device, "*" all attached devices. These take effect with the next capture, one of all
+    // devices starts once 'adb devices' has listed them, see devicesChanged().
+    void setDevices(const QStringList& serials) { serials_ = serials; }
+    const QStringList& devices() const { return serials_; }
+    // Serials of the captured devices by device index.
+    const QStringList& deviceNames() const { return device_names_; }
+    // A logcat that exits is restarted after a delay doubling with each failed attempt up
+    // to `max_msecs`, it resumes from the last row received.
+    void setReconnect(bool enabled, int max_msecs)
+    {
+        reconnect_ = enabled;
+        reconnect_max_msecs_ = std::max(max_msecs, static_cast<int>(Reconnect_Min_Msecs));
+    }
+    bool reconnectEnabled() const { return reconnect_; }
+    int reconnectMaxMsecs() const { return reconnect_max_msecs_; }
+    void setLogcatFormat(LogcatFormat_t format) { format_ = format; }
+    LogcatFormat_t logcatFormat() const { return format_; }
+    void setTeeConfig(const LogcatTeeConfig_t& config) { tee_config_ = config; }
+    const LogcatTeeConfig_t& teeConfig() const { return tee_config_; }
+    bool isTeeActive() const;
+    LogcatTeeStats_t teeStats() const;
+    QString teeFile() const;
+
+    const LogcatProcessInfo_t* findProcess(int pid) const
+    {
+        auto it = logcat_proc_list_.find(pid);
+        return it != logcat_proc_list_.end() ? &it->second : nullptr;
+    }
+    const LogcatProcessList_t& processList() const { return logcat_proc_list_; }
+    const LogcatStringTable& processStrings() const { return proc_strings_; }
+    qint64 lastProcessListMsecs() const { return last_ps_msecs_; }
+    // Evicted rows are dropped, a process without rows left is dropped too.
+    const LogcatPidRows_t& pidRows() const { return pid_rows_; }
+
+    // Opening a capture stops the live capture and replaces all rows and the process table.
+    bool saveCapture(const QString& path, QString& error) const;
+    bool openCapture(const QString& path, QString& error);
+    // Importing a text dump stops the live capture too, the rows are appended as they are parsed.
+    void importLogFile(const QString& path);
+
+  signals:
+    // Emitted before dataChanged() when the process info of the PIDs has changed.
+    void processInfoChanged(const std::vector<int>& pids);
+    void importProgress(qint64 done, qint64 total);
+    // `error` is empty on success.
+    void importFinished(const QString& error);
+    // `device` is an index into deviceNames().
+    void reconnecting(int device, int exitCode, int attempt, int msecs);
+    void reconnected(int device);
+    // deviceNames() has changed, by a new capture or an opened one.
+    void devicesChanged();
+
   public slots:
-    void onReadLogcatStdout();
-    void onLogcatFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void startCapture();
+    void drainReader();
+    void onProcessListUpdated(LogcatPsListPtr_t list, qint64 msecs, int device = 0);
+    void onLogcatFinished(int exitCode, QProcess::ExitStatus exitStatus, int device = 0);
     void tearDown();
 
   protected:
-    virtual std::tuple<QString, QStringList> logcatCommand() const;
-    virtual std::tuple<QString, QStringList> psCommand() const;
+    // An empty serial addresses the only attached device.
+    virtual std::tuple<QString, QStringList> logcatCommand(const QString& serial) const;
+    virtual std::tuple<QString, QStringList> psCommand(const QString& serial) const;
+    // Maps the numeric tags of binary event records to names.
+    virtual std::tuple<QString, QStringList> eventTagsCommand(const QString& serial) const;
+    virtual std::tuple<QString, QStringList> devicesCommand() const;
+    virtual std::shared_ptr<LogcatDecoder> createDecoder() const;
+    // `pids` are process keys, each device's resolver is asked for its own PIDs.
     virtual void updateLogcatProcessList(const QVector<int>& pids);
-    virtual QString findProcessName(const QString& pid) const;
-    virtual QString findProcessPPID(const QString& pid) const;
+    virtual QString findProcessName(int pid) const;
+    virtual QString findProcessPPID(int pid) const;
+    void applyRetention();
+    // Display text of the cached columns, decoded straight from the row.
+    QString cellText(size_t i, int column) const;
+
+  protected:
+    struct Device_t
+    {
+        QString serial;
+        QThread reader_thread;
+        LogcatReader* reader = nullptr;
+        QThread resolver_thread;
+        LogcatProcessResolver* resolver = nullptr;
+        std::shared_ptr<LogcatTeeWriter> tee;
+        QTimer reconnect_timer;
+        QElapsedTimer running;      // since the last (re)start of logcat
+        int reconnect_attempts = 0;
+        int exit_code = 0;
+    };
+
+    void onDevicesListed();
+    void startDevices(const QStringList& serials);
+    Device_t& createDevice(const QString& serial);
+    void startResolver(Device_t& device, int index);
+    void reconnect(int index);
 
   protected:
-    QProcess logcat_proc_;
+    QStringList serials_;
+    QStringList device_names_;
+    QProcess* devices_process_ = nullptr;   // 'adb devices' of a capture of all devices
+    std::vector<std::unique_ptr<Device_t>> devices_;
+    QThread merger_thread_;
+    LogcatMerger* merger_ = nullptr;
+    LogcatBatchQueue* batches_ = nullptr;   // the reader of the only device or the merger
+    LogcatFormat_t format_ = LogcatFormat_t::Text;
+    LogcatTeeConfig_t tee_config_;
+    bool reconnect_ = true;
+    int reconnect_max_msecs_ = 30000;
+    QTimer drain_timer_;
+    bool drain_scheduled_ = false;
+    int ingest_max_rows_ = 5000;
+    int ingest_max_msecs_ = 20;
     LogcatData_t logcat_data_;
+    LogcatRetention_t retention_;
+    LogcatMessageIndex message_index_;
+    mutable LogcatTagIndex tag_index_;
+    LogcatStreamStats stream_stats_;
+    QElapsedTimer stats_clock_;
+    std::shared_ptr<LogcatMetrics> metrics_;
+    uint64_t teardowns_ = 0;                // the ingest counters restart with the readers
+    mutable LogcatCellCache cell_cache_;    // bounded, holds about a few screens of cells
+    mutable LogcatTimeIndex time_index_;
     LogcatProcessList_t logcat_proc_list_;
+    LogcatStringTable proc_strings_;
+    LogcatPidRows_t pid_rows_;
+    std::unordered_set<int> requested_pids_;
+    qint64 last_ps_msecs_ = 0;
 };
 
 
@@ -17,6 +17,10 @@
 #ifndef LOGCATDATAMODEL_DEF_H
 #define LOGCATDATAMODEL_DEF_H
 
+#include <unordered_map>
+
+#include <QString>
+
 
 const int DATE_Column = 0;
 const int TIME_Column = 1;
@@ -27,8 +31,31 @@ const int NAME_Column = 5;
 const int PRIORITY_Column = 6;
 const int TAG_Column = 7;
 const int MESSAGE_Column = 8;
+const int DEVICE_Column = 9;
+
+const int Column_Count = 10;
+
+
+// Process attributes resolved once per `ps` update; strings are ids in the model's string table.
+struct LogcatProcessInfo_t
+{
+    int ppid = 0;
+    int user_id = 0;
+    int name_id = 0;
+    QString pid_text;
+    QString ppid_text;
+};
+
+using LogcatProcessList_t = std::unordered_map<int, LogcatProcessInfo_t>;
+
 
-const int Column_Count = 9;
+struct LogcatStatsRow_t
+{
+    QString name;
+    double lines_per_sec = 0;
+    double bytes_per_sec = 0;
+    double error_per_sec = 0;       // lines/s may be over by this much
+};
 
 
 #endif // LOGCATDATAMODEL_DEF_H
@@ -0,0 +1,365 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "logcatdecoder.h"
+#include "logcatparser.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+
+namespace {
+
+const size_t Entry_V1_Size = 20;
+const size_t Entry_V3_Size = 24;        // v2 has the same size, with the euid for the log id
+const size_t Max_Tag_Size = 4096;
+const size_t Time_Prefix_Size = 15;     // 'MM-DD HH:MM:SS.'
+
+const uint32_t Log_Id_Events = 2;
+const uint32_t Log_Id_Stats = 5;
+const uint32_t Log_Id_Security = 6;
+const uint32_t Log_Id_Max = 8;
+
+enum Event_Type : uint8_t
+{
+    Event_Int = 0,
+    Event_Long = 1,
+    Event_String = 2,
+    Event_List = 3,
+    Event_Float = 4
+};
+
+
+inline uint32_t le16(const char* p)
+{
+    const auto u = reinterpret_cast<const uint8_t*>(p);
+    return u[0] | (u[1] << 8);
+}
+
+
+inline uint32_t le32(const char* p)
+{
+    const auto u = reinterpret_cast<const uint8_t*>(p);
+    return u[0] | (u[1] << 8) | (u[2] << 16) | (static_cast<uint32_t>(u[3]) << 24);
+}
+
+
+inline uint64_t le64(const char* p)
+{
+    return le32(p) | (static_cast<uint64_t>(le32(p + 4)) << 32);
+}
+
+
+// '%*d' without the printf overhead.
+void append_padded(std::string& out, int64_t value, size_t width)
+{
+    char buf[24];
+    auto p = buf + sizeof(buf);
+    const auto negative = value < 0;
+    auto v = negative ? -static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+    do {
+        *--p = static_cast<char>('0' + v % 10);
+        v /= 10;
+    } while (v != 0);
+    if (negative) { *--p = '-'; }
+
+    const auto size = static_cast<size_t>(buf + sizeof(buf) - p);
+    if (size < width) { out.append(width - size, ' '); }
+    out.append(p, size);
+}
+
+
+// android_LogPriority: 2 - VERBOSE ... 8 - SILENT
+inline LogcatPriority_t android_priority(uint8_t p)
+{
+    return p >= 2 && p <= 8 ? static_cast<LogcatPriority_t>(p - 1) : LogcatPriority_t::Unknown;
+}
+
+}
+
+
+size_t LogcatTextDecoder::decode(const char* data, size_t size, LogcatRowSink& sink)
+{
+    size_t pos = 0;
+    while (pos < size) {
+        const auto eol = static_cast<const char*>(std::memchr(data + pos, '\n', size - pos));
+        if (! eol) { break; }
+        const auto line = data + pos;
+        pos = eol - data + 1;
+
+        auto row = LogcatRow_t();
+        if (! parse_threadtime_line(line, eol - line, row)) {
+            malformed_ += 1;
+            continue;
+        }
+        sink.addRow(row, line);
+    }
+    return pos;
+}
+
+
+size_t LogcatBinaryDecoder::decode(const char* data, size_t size, LogcatRowSink& sink)
+{
+    size_t pos = 0;
+    while (size - pos >= Entry_V1_Size) {
+        const auto p = data + pos;
+        const size_t payload_size = le16(p);
+        size_t header_size = le16(p + 2);
+        if (header_size == 0) { header_size = Entry_V1_Size; }  // v1 has padding there
+        if (header_size < Entry_V1_Size || header_size > Max_Header_Size) {
+            // out of sync, look for the next plausible header
+            malformed_ += 1;
+            pos += 1;
+            continue;
+        }
+        if (size - pos < header_size + payload_size) { break; }
+
+        const auto pid = static_cast<int32_t>(le32(p + 4));
+        const auto tid = static_cast<int32_t>(le32(p + 8));
+        // log ids are small, an id out of range is the euid of a v2 header and so are the
+        // fields of the entries to follow
+        uint32_t log_id = 0;
+        if (header_size > Entry_V3_Size || (header_size == Entry_V3_Size && ! euid_headers_)) { log_id = le32(p + 20); }
+        if (header_size == Entry_V3_Size && log_id >= Log_Id_Max) {
+            euid_headers_ = true;
+            log_id = 0;
+        }
+        decodeEntry(pid, tid, le32(p + 12), le32(p + 16), log_id, p + header_size, payload_size, sink);
+        pos += header_size + payload_size;
+    }
+    return pos;
+}
+
+
+std::string LogcatBinaryDecoder::resumeTime() const
+{
+    if (newest_nsecs_ == 0) { return std::string(); }
+    char text[32];
+    std::snprintf(text, sizeof(text), "%llu.%09llu", static_cast<unsigned long long>(newest_nsecs_ / 1000000000),
+                  static_cast<unsigned long long>(newest_nsecs_ % 1000000000));
+    return text;
+}
+
+
+void LogcatBinaryDecoder::decodeEntry(int pid, int tid, uint32_t sec, uint32_t nsec, uint32_t log_id,
+                                      const char* payload, size_t size, LogcatRowSink& sink)
+{
+    pid_ = pid;
+    tid_ = tid;
+    updateTime(sec, nsec);
+    const auto end = payload + size;
+
+    if (log_id == Log_Id_Events || log_id == Log_Id_Stats || log_id == Log_Id_Security) {
+        // int32 tag id followed by a single, possibly nested, typed value
+        if (size < 4) {
+            malformed_ += 1;
+            return;
+        }
+        const auto tag_id = le32(payload);
+        const auto it = event_tags_.find(tag_id);
+        const auto tag = it != event_tags_.end() ? it->second : std::to_string(tag_id);
+
+        message_.clear();
+        auto p = payload + 4;
+        if (p < end && ! formatEvent(p, end, 0, message_)) { malformed_ += 1; }
+        emitRows(LogcatPriority_t::Info, tag, message_, sink);
+        return;
+    }
+
+    // priority byte, NUL-terminated tag, message with an optional NUL terminator
+    if (size < 2) {
+        malformed_ += 1;
+        return;
+    }
+    const auto tag_begin = payload + 1;
+    const auto tag_end = static_cast<const char*>(std::memchr(tag_begin, '\0', end - tag_begin));
+    if (! tag_end) {
+        malformed_ += 1;
+        return;
+    }
+    const auto msg_begin = tag_end + 1;
+    auto msg_end = static_cast<const char*>(std::memchr(msg_begin, '\0', end - msg_begin));
+    if (! msg_end) { msg_end = end; }
+    while (msg_end > msg_begin && (msg_end[-1] == '\n' || msg_end[-1] == '\r')) { --msg_end; }
+
+    emitRows(android_priority(static_cast<uint8_t>(payload[0])),
+             std::string_view(tag_begin, tag_end - tag_begin),
+             std::string_view(msg_begin, msg_end - msg_begin), sink);
+}
+
+
+bool LogcatBinaryDecoder::formatEvent(const char*& p, const char* end, int depth, std::string& out) const
+{
+    if (p >= end || depth > Max_Event_Depth) { return false; }
+
+    const auto type = static_cast<uint8_t>(*p++);
+    switch (type) {
+    case Event_Int:
+        if (end - p < 4) { return false; }
+        out += std::to_string(static_cast<int32_t>(le32(p)));
+        p += 4;
+        return true;
+    case Event_Long:
+        if (end - p < 8) { return false; }
+        out += std::to_string(static_cast<int64_t>(le64(p)));
+        p += 8;
+        return true;
+    case Event_Float: {
+        if (end - p < 4) { return false; }
+        const auto bits = le32(p);
+        auto value = 0.0f;
+        std::memcpy(&value, &bits, sizeof(value));
+        char buf[64];
+        const auto n = std::snprintf(buf, sizeof(buf), "%f", static_cast<double>(value));
+        out.append(buf, static_cast<size_t>(std::max(0, std::min(n, static_cast<int>(sizeof(buf)) - 1))));
+        p += 4;
+        return true;
+    }
+    case Event_String: {
+        if (end - p < 4) { return false; }
+        const auto n = static_cast<size_t>(le32(p));
+        p += 4;
+        const auto available = static_cast<size_t>(end - p);
+        out.append(p, std::min(n, available));
+        p += std::min(n, available);
+        return n <= available;
+    }
+    case Event_List: {
+        if (p >= end) { return false; }
+        const auto count = static_cast<uint8_t>(*p++);
+        out += '[';
+        for (int i = 0; i < count; ++i) {
+            if (i > 0) { out += ','; }
+            if (! formatEvent(p, end, depth + 1, out)) { return false; }
+        }
+        out += ']';
+        return true;
+    }
+    }
+    return false;
+}
+
+
+void LogcatBinaryDecoder::emitRows(LogcatPriority_t priority, std::string_view tag, std::string_view message,
+                                   LogcatRowSink& sink)
+{
+    if (tag.empty()) { tag = "?"; }
+    if (tag.size() > Max_Tag_Size) { tag = tag.substr(0, Max_Tag_Size); }
+
+    size_t begin = 0;
+    for (;;) {
+        const auto nl = message.find('\n', begin);
+        const auto piece = message.substr(begin, nl == std::string_view::npos ? std::string_view::npos : nl - begin);
+
+        auto row = LogcatRow_t();
+        line_.assign(header_, header_size_);
+        append_padded(line_, pid_, 5);
+        line_ += ' ';
+        append_padded(line_, tid_, 5);
+        line_ += ' ';
+        row.priority_offset = static_cast<uint8_t>(line_.size());
+        line_ += priority_to_char(priority);
+        line_ += ' ';
+        row.tag_offset = static_cast<uint16_t>(line_.size());
+        line_.append(tag.data(), tag.size());
+        if (tag.size() < 8) { line_.append(8 - tag.size(), ' '); }  // '%-8s' as in the text output
+        line_ += ": ";
+        row.message_offset = static_cast<uint16_t>(line_.size());
+        line_.append(piece.data(), piece.size());
+
+        row.timestamp = timestamp_;
+        row.size = static_cast<uint32_t>(line_.size());
+        row.pid = pid_;
+        row.tid = tid_;
+        row.tag_size = static_cast<uint16_t>(tag.size());
+        row.date_size = 5;
+        row.time_offset = 6;
+        row.time_size = 18;
+        row.priority_size = 1;
+        row.priority = priority;
+        sink.addRow(row, line_.data());
+
+        if (nl == std::string_view::npos) { break; }
+        begin = nl + 1;
+    }
+}
+
+
+void LogcatBinaryDecoder::updateTime(uint32_t sec, uint32_t nsec)
+{
+    // 'MM-DD HH:MM:SS.' changes once a second at most
+    if (sec != cached_sec_) {
+        cached_sec_ = sec;
+        const auto t = static_cast<std::time_t>(sec);
+#if defined(_WIN32)
+        localtime_s(&cached_tm_, &t);
+#else
+        localtime_r(&t, &cached_tm_);
+#endif
+        const auto& tm = cached_tm_;
+        std::snprintf(header_, sizeof(header_), "%02d-%02d %02d:%02d:%02d.",
+                      tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+    }
+    if (nsec >= 1000000000) { nsec = 999999999; }
+    newest_nsecs_ = std::max(newest_nsecs_, static_cast<uint64_t>(sec) * 1000000000 + nsec);
+
+    auto v = nsec;
+    for (int i = 8; i >= 0; --i) {
+        header_[Time_Prefix_Size + i] = static_cast<char>('0' + v % 10);
+        v /= 10;
+    }
+    header_[Time_Prefix_Size + 9] = ' ';
+    header_size_ = Time_Prefix_Size + 10;
+
+    const auto& tm = cached_tm_;
+    timestamp_ = pack_timestamp(tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, static_cast<int>(nsec));
+}
+
+
+LogcatBinaryDecoder::EventTags_t LogcatBinaryDecoder::parseEventTags(std::string_view text)
+{
+    auto tags = EventTags_t();
+    size_t pos = 0;
+    while (pos < text.size()) {
+        auto eol = text.find('\n', pos);
+        if (eol == std::string_view::npos) { eol = text.size(); }
+        auto line = text.substr(pos, eol - pos);
+        pos = eol + 1;
+
+        size_t i = 0;
+        while (i < line.size() && (line[i] == ' ' || line[i] == '\t')) { ++i; }
+        if (i == line.size() || line[i] < '0' || line[i] > '9') { continue; }  // comments and blank lines
+        uint32_t id = 0;
+        while (i < line.size() && line[i] >= '0' && line[i] <= '9') { id = id * 10 + (line[i++] - '0'); }
+        while (i < line.size() && (line[i] == ' ' || line[i] == '\t')) { ++i; }
+        const auto name_begin = i;
+        while (i < line.size() && line[i] != ' ' && line[i] != '\t' && line[i] != '\r' && line[i] != '(') { ++i; }
+        if (i > name_begin) { tags[id] = std::string(line.substr(name_begin, i - name_begin)); }
+    }
+    return tags;
+}
+
+
+std::unique_ptr<LogcatDecoder> make_decoder(LogcatFormat_t format)
+{
+    switch (format) {
+    case LogcatFormat_t::Binary: return std::make_unique<LogcatBinaryDecoder>();
+    case LogcatFormat_t::Text: break;
+    }
+    return std::make_unique<LogcatTextDecoder>();
+}
@@ -0,0 +1,125 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef LOGCATDECODER_H
+#define LOGCATDECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "logcatstore.h"
+
+
+enum class LogcatFormat_t
+{
+    Text,       // 'logcat -v threadtime'
+    Binary      // 'logcat -B', struct logger_entry records
+};
+
+
+// Receives decoded rows. `line` holds the row.size bytes of the row text, the offsets
+// of `row` are relative to it.
+class LogcatRowSink
+{
+  public:
+    virtual ~LogcatRowSink() = default;
+    virtual void addRow(const LogcatRow_t& row, const char* line) = 0;
+};
+
+
+// Turns raw logcat output into rows. The output arrives in arbitrary pieces, decode()
+// consumes complete records only and returns the number of bytes used, the caller
+// passes the rest again together with the next piece.
+class LogcatDecoder
+{
+  public:
+    virtual ~LogcatDecoder() = default;
+    virtual size_t decode(const char* data, size_t size, LogcatRowSink& sink) = 0;
+    // 'logcat -T' time of the newest record decoded so far, in a form that does not depend
+    // on the device's timezone. Empty if the time of the rows has to do.
+    virtual std::string resumeTime() const { return std::string(); }
+
+    // Records that could not be decoded and were skipped.
+    uint64_t malformed() const { return malformed_; }
+
+  protected:
+    uint64_t malformed_ = 0;
+};
+
+
+class LogcatTextDecoder : public LogcatDecoder
+{
+  public:
+    size_t decode(const char* data, size_t size, LogcatRowSink& sink) override;
+};
+
+
+// Decodes struct logger_entry records (header versions 1 to 4) as written by
+// 'logcat -B'. Each row gets a synthesized 'threadtime' line with nanoseconds,
+// so the rest of the app handles both formats alike; multi-line messages become
+// one row per line, as in the text output. Binary records of the events, stats and
+// security buffers are formatted the way logcat does, tag names come from
+// setEventTags(). v2 and v3 headers are alike but for the euid in place of the log id,
+// a stream is taken for v2 once a 24 byte header has an id out of range.
+class LogcatBinaryDecoder : public LogcatDecoder
+{
+  public:
+    using EventTags_t = std::unordered_map<uint32_t, std::string>;
+
+    static const size_t Max_Header_Size = 64;
+    static const int Max_Event_Depth = 8;
+
+    size_t decode(const char* data, size_t size, LogcatRowSink& sink) override;
+    // Seconds since the epoch, 'sssss.nnnnnnnnn'.
+    std::string resumeTime() const override;
+
+    void setEventTags(EventTags_t tags) { event_tags_ = std::move(tags); }
+    // Parses /system/etc/event-log-tags: '<id> <name> [(<field>|<type>)...]' per line.
+    static EventTags_t parseEventTags(std::string_view text);
+
+  private:
+    void decodeEntry(int pid, int tid, uint32_t sec, uint32_t nsec, uint32_t log_id,
+                     const char* payload, size_t size, LogcatRowSink& sink);
+    bool formatEvent(const char*& p, const char* end, int depth, std::string& out) const;
+    void emitRows(LogcatPriority_t priority, std::string_view tag, std::string_view message, LogcatRowSink& sink);
+    void updateTime(uint32_t sec, uint32_t nsec);
+
+  private:
+    EventTags_t event_tags_;
+    std::string line_;
+    std::string message_;
+    int64_t cached_sec_ = -1;
+    std::tm cached_tm_ = {};
+    char header_[64] = {};
+    size_t header_size_ = 0;
+    int pid_ = 0;
+    int tid_ = 0;
+    LogcatTimestamp_t timestamp_ = 0;
+    uint64_t newest_nsecs_ = 0;         // since the epoch, rows have the host's local time
+    bool euid_headers_ = false;         // the 24 byte headers are v2 ones
+};
+
+
+std::unique_ptr<LogcatDecoder> make_decoder(LogcatFormat_t format);
+
+
+#endif // LOGCATDECODER_H
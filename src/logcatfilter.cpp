@@ -0,0 +1,439 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "pch.h"
+#include "logcatfilter.h"
+#include "logcatparser.h"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+
+static QString to_qstring(std::string_view s)
+{
+    return QString::fromUtf8(s.data(), static_cast<int>(s.size()));
+}
+
+
+LogcatFilter::LogcatFilter(const LogcatFilterPattern_t& pattern)
+        : pattern_(pattern)
+        , pid_(compile(pattern, PID_Regex, PID_Regex_Inverted))
+        , ppid_(compile(pattern, PPID_Regex, PPID_Regex_Inverted))
+        , name_(compile(pattern, NAME_Regex, NAME_Regex_Inverted))
+        , priority_(compile(pattern, PRIORITY_Regex, PRIORITY_Regex_Inverted))
+        , tag_(compile(pattern, TAG_Regex, TAG_Regex_Inverted))
+        , message_(compile(pattern, MESSAGE_Regex, MESSAGE_Regex_Inverted))
+        , device_(compile(pattern, DEVICE_Regex, DEVICE_Regex_Inverted))
+        , time_from_(compileTime(pattern, TIME_From, false))
+        , time_to_(compileTime(pattern, TIME_To, true))
+{
+    if (priority_.active) {
+        // a threshold such as '>=W' selects the priorities by their order, not by the letter
+        static const auto threshold_re = QRegularExpression(QStringLiteral("^\\s*([<>]=?)\\s*([VDIWEFS])\\s*$"),
+                                                            QRegularExpression::CaseInsensitiveOption);
+        const auto threshold = threshold_re.match(priority_.regex.pattern());
+        priority_threshold_ = threshold.hasMatch();
+        const auto op = threshold.captured(1);
+        const auto level = threshold.captured(2).toUpper();
+
+        priority_mask_ = 0;
+        auto bound = 0;
+        for (int p = static_cast<int>(LogcatPriority_t::Verbose); p <= static_cast<int>(LogcatPriority_t::Silent); ++p) {
+            const auto c = QString(QChar::fromLatin1(priority_to_char(static_cast<LogcatPriority_t>(p))));
+            if (priority_threshold_) {
+                if (c == level) { bound = p; }
+            } else if (priority_(c)) {
+                priority_mask_ |= 1u << p;
+            }
+        }
+        if (priority_threshold_) {
+            for (int p = static_cast<int>(LogcatPriority_t::Verbose); p <= static_cast<int>(LogcatPriority_t::Silent); ++p) {
+                const auto in = op == QLatin1String(">=") ? p >= bound : op == QLatin1String(">") ? p > bound
+                        : op == QLatin1String("<=") ? p <= bound : p < bound;
+                if (in != priority_.inverted) { priority_mask_ |= 1u << p; }
+            }
+        }
+    }
+    if (message_.active && ! message_.inverted) {
+        message_literals_ = requiredLiterals(message_.regex.pattern());
+    }
+    setDeviceNames(QStringList());
+    time_active_ = time_from_.active || time_to_.active;
+    resolveTimeWindow();
+    accepts_all_ = ! (pid_.active || ppid_.active || name_.active || priority_.active || tag_.active || message_.active
+                      || device_.active || time_active_);
+}
+
+
+bool parse_time_text(const QString& text, LogcatTimestamp_t& t, bool& has_date, int64_t& precision)
+{
+    static const auto re = QRegularExpression(
+                QStringLiteral("^\\s*(?:(\\d{1,2})-(\\d{1,2})\\s+)?(\\d{1,2}):(\\d{2})(?::(\\d{2})(?:\\.(\\d{1,9}))?)?\\s*$"));
+    const auto m = re.match(text);
+    if (! m.hasMatch()) { return false; }
+
+    has_date = m.capturedLength(1) > 0;
+    const auto month = has_date ? m.captured(1).toInt() : 0;
+    const auto day = has_date ? m.captured(2).toInt() : 0;
+    const auto hour = m.captured(3).toInt();
+    const auto minute = m.captured(4).toInt();
+    const auto second = m.captured(5).toInt();
+    const auto fraction = m.captured(6);
+    if ((has_date && (month < 1 || month > 12 || day < 1 || day > 31)) || hour > 23 || minute > 59 || second > 59) {
+        return false;
+    }
+
+    int nsec = 0;
+    precision = m.capturedLength(5) > 0 ? 1000000000 : 60LL * 1000000000;
+    if (! fraction.isEmpty()) {
+        nsec = fraction.leftJustified(9, QLatin1Char('0')).toInt();
+        precision = 1;
+        for (auto n = fraction.size(); n < 9; ++n) { precision *= 10; }
+    }
+    t = pack_timestamp(month, day, hour, minute, second, nsec);
+    return true;
+}
+
+
+LogcatFilter::TimeBound_t LogcatFilter::compileTime(const LogcatFilterPattern_t& pattern, int id, bool upper)
+{
+    auto bound = TimeBound_t();
+    auto it = pattern.find(id);
+    int64_t precision = 1;
+    if (it == pattern.end() || ! parse_time_text(it->second, bound.t, bound.has_date, precision)) { return bound; }
+
+    bound.active = true;
+    if (upper) { bound.t += precision - 1; }
+    return bound;
+}
+
+
+void LogcatFilter::resolveTimeWindow()
+{
+    if (! time_active_) { return; }
+
+    // a bound left out is open, the other one supplies the date if it has one
+    const auto has_date = (! time_from_.active || time_from_.has_date) && (! time_to_.active || time_to_.has_date);
+    auto date = LogcatTimestamp_t(-1);
+    if (time_from_.active && time_from_.has_date) { date = time_from_.t; }
+    if (time_to_.active && time_to_.has_date) { date = time_to_.t; }
+    if (! has_date && date < 0 && store_ && ! store_->empty()) { date = store_->row(store_->size() - 1).timestamp; }
+
+    time_of_day_ = ! has_date && date < 0;
+    auto resolve = [this, date](const TimeBound_t& b, LogcatTimestamp_t open) {
+        if (! b.active) { return open; }
+        if (b.has_date || time_of_day_) { return time_of_day_ ? b.t % Nanos_Per_Day : b.t; }
+        return with_date(b.t, date);
+    };
+    from_ = resolve(time_from_, std::numeric_limits<LogcatTimestamp_t>::min());
+    to_ = resolve(time_to_, std::numeric_limits<LogcatTimestamp_t>::max());
+}
+
+
+bool LogcatFilter::timeWindow(LogcatTimestamp_t& from, LogcatTimestamp_t& to) const
+{
+    if (! time_active_ || time_of_day_) { return false; }
+    from = from_;
+    to = to_;
+    return true;
+}
+
+
+LogcatFilter::Test_t LogcatFilter::compile(const LogcatFilterPattern_t& pattern, int regex_id, int flag_id)
+{
+    auto value = [&pattern](int id) {
+        auto it = pattern.find(id);
+        return it != pattern.end() ? it->second : QString();
+    };
+
+    auto test = Test_t();
+    const auto regex = value(regex_id);
+    test.inverted = value(flag_id).size() > 0;
+    test.active = regex.size() > 0 || test.inverted;  // an empty pattern matches everything
+    test.regex = QRegularExpression(regex);
+    test.regex.optimize();
+
+    auto literals = std::vector<std::string>();
+    test.is_literal = parseLiterals(regex, literals);
+    if (test.is_literal) { test.literal = LogcatLiteralMatcher(std::move(literals)); }
+    return test;
+}
+
+
+bool LogcatFilter::Test_t::operator()(std::string_view utf8) const
+{
+    return (is_literal ? literal.contains(utf8) : to_qstring(utf8).contains(regex)) != inverted;
+}
+
+
+bool LogcatFilter::parseLiterals(const QString& regex, std::vector<std::string>& literals)
+{
+    // literal characters and escaped punctuation only, alternatives split on '|'
+    static const auto special = QStringLiteral("\\^$.|?*+()[]{}");
+
+    auto alternative = QString();
+    for (int i = 0; i < regex.size(); ++i) {
+        auto c = regex[i];
+        if (c == QLatin1Char('|')) {
+            literals.push_back(alternative.toStdString());
+            alternative.clear();
+            continue;
+        }
+        if (c == QLatin1Char('\\')) {
+            if (i + 1 == regex.size()) { return false; }
+            c = regex[++i];
+            if (c.unicode() >= 0x80 || c.isLetterOrNumber()) { return false; }
+        } else if (special.contains(c)) {
+            return false;
+        }
+        alternative.append(c);
+    }
+    literals.push_back(alternative.toStdString());
+    return true;
+}
+
+
+std::vector<std::string> LogcatFilter::requiredLiterals(const QString& regex)
+{
+    // Conservative scan for runs of plain characters outside of any group or class: an
+    // alternation anywhere gives up, a quantified atom is dropped from its run. Only ASCII
+    // is kept, so the runs are valid for the case-folded message index. Escapes that take
+    // operands (\x41, \101, \cA, \p{L}, ...) and the x flag give up too, rather than
+    // reading their operands as literal text.
+    static const auto plain_escapes = QStringLiteral("dDsSwWbBAzZGhHvVRXKaefnrt");
+
+    auto literals = std::vector<std::string>();
+    if (regex.contains(QLatin1Char('|')) || regex.contains(QLatin1String("\\Q"))) { return literals; }
+
+    auto run = std::string();
+    auto flush = [&literals, &run]() {
+        if (! run.empty()) { literals.push_back(run); }
+        run.clear();
+    };
+
+    int depth = 0;
+    for (int i = 0; i < regex.size(); ++i) {
+        const auto c = regex[i].unicode();
+        bool literal = false;
+        if (c == '\\' && i + 1 < regex.size()) {
+            const auto e = regex[++i];
+            if (e.isLetterOrNumber() && ! plain_escapes.contains(e)) { return {}; }
+            literal = e.unicode() < 0x80 && ! e.isLetterOrNumber();
+        } else if (c == '[') {
+            i += 1;
+            if (i < regex.size() && regex[i] == QLatin1Char('^')) { i += 1; }
+            if (i < regex.size() && regex[i] == QLatin1Char(']')) { i += 1; }
+            for (; i < regex.size() && regex[i] != QLatin1Char(']'); ++i) {
+                if (regex[i] == QLatin1Char('\\')) { i += 1; }
+            }
+        } else if (c == '(') {
+            depth += 1;
+            // inline options such as (?x) or (?i-x:...)
+            if (i + 1 < regex.size() && regex[i + 1] == QLatin1Char('?')) {
+                for (int j = i + 2; j < regex.size() && (regex[j].isLetter() || regex[j] == QLatin1Char('-')); ++j) {
+                    if (regex[j] == QLatin1Char('x')) { return {}; }
+                }
+            }
+        } else if (c == ')') {
+            depth -= 1;
+        } else if (c == '*' || c == '?' || c == '{' || c == '+') {
+            // the previous atom may be absent or repeated, either way the run ends
+            if (c != '+' && ! run.empty()) { run.pop_back(); }
+            if (c == '{') {
+                while (i < regex.size() && regex[i] != QLatin1Char('}')) { i += 1; }
+            }
+            if (i + 1 < regex.size() && (regex[i + 1] == QLatin1Char('?') || regex[i + 1] == QLatin1Char('+'))) { i += 1; }
+        } else {
+            literal = c < 0x80 && c != '.' && c != '^' && c != '$';
+        }
+
+        if (literal && depth == 0) {
+            run.push_back(static_cast<char>(regex[i].unicode()));
+        } else {
+            flush();
+        }
+    }
+    flush();
+    return literals;
+}
+
+
+void LogcatFilter::bind(const LogcatStore* store, const LogcatProcessList_t* processes, const LogcatStringTable* strings)
+{
+    store_ = store;
+    processes_ = processes;
+    strings_ = strings;
+    pid_verdict_.clear();
+    resolveTimeWindow();
+}
+
+
+void LogcatFilter::setDeviceNames(const QStringList& names)
+{
+    if (! device_.active) { return; }
+
+    device_mask_ = 0;
+    for (int i = 0; i < Max_Devices; ++i) {
+        if (device_(i < names.size() ? names[i] : QString())) { device_mask_ |= 1ull << i; }
+    }
+}
+
+
+void LogcatFilter::resetProcessInfo()
+{
+    pid_verdict_.clear();
+}
+
+
+std::vector<int> LogcatFilter::refreshProcessInfo(const std::vector<int>& pids)
+{
+    auto flipped = std::vector<int>();
+    if (! (pid_.active || ppid_.active || name_.active)) { return flipped; }
+    for (auto pid : pids) {
+        auto it = pid_verdict_.find(pid);
+        if (it == pid_verdict_.end()) { continue; }
+        const auto verdict = evalPid(pid);
+        if (verdict != it->second) {
+            it->second = verdict;
+            flipped.push_back(pid);
+        }
+    }
+    return flipped;
+}
+
+
+void LogcatFilter::primeProcessInfo(const std::vector<int>& pids)
+{
+    if (! (pid_.active || ppid_.active || name_.active)) { return; }
+    for (auto pid : pids) { acceptsPid(pid); }
+}
+
+
+LogcatFilter LogcatFilter::detached() const
+{
+    auto filter = *this;
+    filter.store_ = nullptr;
+    filter.processes_ = nullptr;
+    filter.strings_ = nullptr;
+    return filter;
+}
+
+
+bool LogcatFilter::acceptsRow(const LogcatRow_t& row, const char* line, bool indexed) const
+{
+    if (priority_.active) {
+        if (row.priority != LogcatPriority_t::Unknown) {
+            if (! indexed && ! (priority_mask_ & (1u << static_cast<int>(row.priority)))) { return false; }
+        } else if (priority_threshold_ || ! priority_(std::string_view(line + row.priority_offset, row.priority_size))) {
+            return false;
+        }
+    }
+
+    if (time_active_) {
+        const auto t = time_of_day_ ? row.timestamp % Nanos_Per_Day : row.timestamp;
+        if (t < from_ || t > to_) { return false; }
+    }
+
+    if (device_.active && (row.device >= Max_Devices || ! (device_mask_ & (1ull << row.device)))) { return false; }
+
+    if ((pid_.active || ppid_.active || name_.active) && ! acceptsPid(process_key(row))) { return false; }
+
+    if (tag_.active && ! indexed && ! tag_(std::string_view(line + row.tag_offset, row.tag_size))) { return false; }
+
+    if (message_.active && ! message_(std::string_view(line + row.message_offset, row.size - row.message_offset))) {
+        return false;
+    }
+
+    return true;
+}
+
+
+bool LogcatFilter::acceptsPid(int pid) const
+{
+    auto it = pid_verdict_.find(pid);
+    if (it != pid_verdict_.end()) { return it->second; }
+    const auto verdict = evalPid(pid);
+    pid_verdict_.emplace(pid, verdict);
+    return verdict;
+}
+
+
+bool LogcatFilter::evalPid(int pid) const
+{
+    const LogcatProcessInfo_t* proc = nullptr;
+    if (processes_) {
+        auto it = processes_->find(pid);
+        if (it != processes_->end()) { proc = &it->second; }
+    }
+
+    if (pid_.active && ! pid_(proc ? proc->pid_text : QString::number(process_key_pid(pid)))) { return false; }
+    if (ppid_.active && ! ppid_(proc ? proc->ppid_text : QString())) { return false; }
+    if (name_.active && ! name_(proc && strings_ ? strings_->at(proc->name_id) : QString())) { return false; }
+    return true;
+}
+
+
+bool filter_snapshot(const LogcatFilter& filter, const LogcatStoreSnapshot_t& snapshot, int threads,
+                     const std::atomic<bool>& cancelled, std::vector<uint64_t>& accepted)
+{
+    // small enough to balance the load, large enough to keep the merge cheap
+    const size_t Chunk_Blocks = 4;
+
+    const auto block_count = snapshot.blocks.size();
+    const auto chunk_count = (block_count + Chunk_Blocks - 1) / Chunk_Blocks;
+    const auto base_seq = snapshot.first_seq - snapshot.head;
+    const auto end_seq = snapshot.first_seq + snapshot.size;
+    auto chunks = std::vector<std::vector<uint64_t>>(chunk_count);
+    auto next_chunk = std::atomic<size_t>(0);
+
+    auto worker = [&]() {
+        // each thread fills its own verdict cache
+        const auto local = filter;
+        for (auto c = next_chunk++; c < chunk_count && ! cancelled; c = next_chunk++) {
+            auto& out = chunks[c];
+            const auto last_block = std::min(block_count, (c + 1) * Chunk_Blocks);
+            for (auto b = c * Chunk_Blocks; b < last_block && ! cancelled; ++b) {
+                auto block = snapshot.blocks[b];
+                if (! block) { block = snapshot.source->load(snapshot.source_first + b); }
+                auto seq = base_seq + b * LogcatStore::Block_Rows;
+                for (const auto& row : block->rows) {
+                    if (seq >= snapshot.first_seq && seq < end_seq
+                            && local.accepts(row, block->bytes.data() + row.offset)) {
+                        out.push_back(seq);
+                    }
+                    seq += 1;
+                }
+            }
+        }
+    };
+
+    threads = std::max(1, std::min(threads, static_cast<int>(chunk_count)));
+    auto pool = std::vector<std::thread>();
+    for (int i = 1; i < threads; ++i) { pool.emplace_back(worker); }
+    worker();
+    for (auto& thread : pool) { thread.join(); }
+
+    if (cancelled) { return false; }
+
+    size_t total = 0;
+    for (const auto& chunk : chunks) { total += chunk.size(); }
+    accepted.clear();
+    accepted.reserve(total);
+    for (const auto& chunk : chunks) { accepted.insert(accepted.end(), chunk.begin(), chunk.end()); }
+    return true;
+}
@@ -0,0 +1,185 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef LOGCATFILTER_H
+#define LOGCATFILTER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+
+#include "logcatdatamodel_def.h"
+#include "logcatliteralmatcher.h"
+#include "logcatstore.h"
+#include "logcatstringtable.h"
+
+
+const int PID_Regex = 1;
+const int PID_Regex_Inverted = 2;
+const int PRIORITY_Regex = 3;
+const int PRIORITY_Regex_Inverted = 4;
+const int TAG_Regex = 5;
+const int TAG_Regex_Inverted = 6;
+const int NAME_Regex = 7;
+const int NAME_Regex_Inverted = 8;
+const int PPID_Regex = 9;
+const int PPID_Regex_Inverted = 10;
+const int MESSAGE_Regex = 11;
+const int MESSAGE_Regex_Inverted = 12;
+const int DEVICE_Regex = 13;
+const int DEVICE_Regex_Inverted = 14;
+const int TIME_From = 15;               // '[MM-DD ]HH:MM[:SS[.fff]]', inclusive
+const int TIME_To = 16;
+
+
+using LogcatFilterPattern_t = std::unordered_map<int, QString>;
+
+
+// Parses '[MM-DD ]HH:MM[:SS[.fff]]'. Without a date `t` is the time of day and `has_date`
+// is false. `precision` is the unit of the last field given, in nanoseconds, so a range
+// up to `t` ends at t + precision - 1.
+bool parse_time_text(const QString& text, LogcatTimestamp_t& t, bool& has_date, int64_t& precision);
+
+
+// Filter pattern compiled into a row predicate over the store fields.
+//
+// Each test keeps the semantics of `field.contains(regex) != inverted`, but it is
+// evaluated on the cheapest representation available: priorities and devices as bit masks,
+// PID/PPID/NAME as a per-process verdict, and only the tag and the message are matched per
+// row, directly on the UTF-8 bytes when the pattern is a literal or an alternation of them.
+// Processes are identified by process_key(), "PIDs" below are such keys.
+class LogcatFilter
+{
+  public:
+    explicit LogcatFilter(const LogcatFilterPattern_t& pattern = LogcatFilterPattern_t());
+
+    // The filter reads rows and process info through these until the next bind().
+    // Dateless TIME bounds take the date of the newest row of `store`, or match the time of
+    // day of any date if it is empty. The date is resolved here only, so once a live capture
+    // crosses midnight the window stays on the previous day until the filter is bound again.
+    void bind(const LogcatStore* store, const LogcatProcessList_t* processes, const LogcatStringTable* strings);
+    // Names the DEVICE test is matched against, by device index.
+    void setDeviceNames(const QStringList& names);
+    // Forget the cached per-PID verdicts after the process table has changed.
+    void resetProcessInfo();
+    // Re-evaluate the cached verdicts of the given PIDs, returns the PIDs whose verdict has flipped.
+    // PIDs without a cached verdict are skipped: none of their rows has reached the PID test yet.
+    std::vector<int> refreshProcessInfo(const std::vector<int>& pids);
+    // Cache the verdicts of the PIDs ahead of detached().
+    void primeProcessInfo(const std::vector<int>& pids);
+    // Copy that evaluates rows without touching the bound store and process table, for use
+    // off the GUI thread. PIDs without a cached verdict are treated as unknown processes.
+    LogcatFilter detached() const;
+
+    bool accepts(size_t row) const { return accepts_all_ || accepts(store_->row(row), store_->line(row)); }
+    bool accepts(const LogcatRow_t& row, const char* line) const { return accepts_all_ || acceptsRow(row, line, false); }
+    // A row the tag index has selected with tagTest() and indexPriorityMask(), those
+    // tests are not repeated.
+    bool acceptsIndexed(size_t row) const { return accepts_all_ || acceptsRow(store_->row(row), store_->line(row), true); }
+
+    bool acceptsAll() const { return accepts_all_; }
+    const LogcatFilterPattern_t& pattern() const { return pattern_; }
+    // The tag and priority tests can be answered by a LogcatTagIndex.
+    bool usesTagIndex() const { return tag_.active || priority_.active; }
+    // The tag test for LogcatTagIndex::select(), empty if there is none.
+    std::function<bool(std::string_view)> tagTest() const
+    {
+        if (! tag_.active) { return nullptr; }
+        return [this](std::string_view utf8) { return tag_(utf8); };
+    }
+    // A bit per LogcatPriority_t, rows of an unknown priority are selected to be tested by
+    // their text, unless a threshold rules them out.
+    uint32_t indexPriorityMask() const { return priority_mask_ | (priority_threshold_ ? 0u : 1u); }
+    // The time window with dates resolved, false if there is none or it matches times of day.
+    bool timeWindow(LogcatTimestamp_t& from, LogcatTimestamp_t& to) const;
+    bool dependsOnProcessInfo() const { return ppid_.active || name_.active; }
+    // Substrings every accepted message contains, empty if the message test cannot tell.
+    const std::vector<std::string>& messageLiterals() const { return message_literals_; }
+
+  private:
+    struct Test_t
+    {
+        QRegularExpression regex;
+        LogcatLiteralMatcher literal;
+        bool is_literal = false;
+        bool active = false;
+        bool inverted = false;
+
+        bool operator()(const QString& s) const { return s.contains(regex) != inverted; }
+        bool operator()(std::string_view utf8) const;
+    };
+
+    struct TimeBound_t
+    {
+        LogcatTimestamp_t t = 0;
+        bool active = false;
+        bool has_date = false;
+    };
+
+    static Test_t compile(const LogcatFilterPattern_t& pattern, int regex_id, int flag_id);
+    static TimeBound_t compileTime(const LogcatFilterPattern_t& pattern, int id, bool upper);
+    void resolveTimeWindow();
+    static std::vector<std::string> requiredLiterals(const QString& regex);
+    static bool parseLiterals(const QString& regex, std::vector<std::string>& literals);
+    bool acceptsRow(const LogcatRow_t& row, const char* line, bool indexed) const;
+    bool acceptsPid(int pid) const;
+    bool evalPid(int pid) const;
+
+  private:
+    LogcatFilterPattern_t pattern_;
+    Test_t pid_;
+    Test_t ppid_;
+    Test_t name_;
+    Test_t priority_;
+    Test_t tag_;
+    Test_t message_;
+    Test_t device_;
+    TimeBound_t time_from_;
+    TimeBound_t time_to_;
+    bool time_active_ = false;
+    bool time_of_day_ = false;          // the bounds are times of day, dates are not compared
+    LogcatTimestamp_t from_ = 0;
+    LogcatTimestamp_t to_ = 0;
+    std::vector<std::string> message_literals_;
+    uint32_t priority_mask_ = ~0u;      // bit per LogcatPriority_t
+    bool priority_threshold_ = false;   // a '>= W' style pattern, it has no text test
+    uint64_t device_mask_ = ~0ull;      // bit per device index
+    bool accepts_all_ = true;
+
+    const LogcatStore* store_ = nullptr;
+    const LogcatProcessList_t* processes_ = nullptr;
+    const LogcatStringTable* strings_ = nullptr;
+    mutable std::unordered_map<int, bool> pid_verdict_;
+};
+
+
+// Filters the rows of `snapshot` on `threads` threads, each taking chunks of blocks in turn.
+// The per-chunk results are merged in store order into `accepted` as sequence numbers.
+// Returns false if `cancelled` was raised before the whole snapshot was filtered.
+bool filter_snapshot(const LogcatFilter& filter, const LogcatStoreSnapshot_t& snapshot, int threads,
+                     const std::atomic<bool>& cancelled, std::vector<uint64_t>& accepted);
+
+
+#endif // LOGCATFILTER_H
@@ -16,11 +16,15 @@
 
 #include "pch.h"
 #include "logcatfilterproxy.h"
+#include "logcatdatamodel.h"
 #include "logcatdatamodel_def.h"
+#include <algorithm>
+
+#include <QElapsedTimer>
 
 
 LogcatFilterProxy::LogcatFilterProxy(QObject* parent)
-        : QSortFilterProxyModel(parent)
+        : QAbstractProxyModel(parent)
 {
     const auto empty = QStringLiteral("");
     setFilterPattern({
@@ -33,48 +37,557 @@ LogcatFilterProxy::LogcatFilterProxy(QObject* parent)
         {NAME_Regex, empty},
         {NAME_Regex_Inverted, empty},
         {PPID_Regex, empty},
-        {PPID_Regex_Inverted, empty}
+        {PPID_Regex_Inverted, empty},
+        {MESSAGE_Regex, empty},
+        {MESSAGE_Regex_Inverted, empty}
     });
 }
 
 
 LogcatFilterProxy::~LogcatFilterProxy()
-{}
+{
+    cancelRefilter();
+}
 
 
-bool LogcatFilterProxy::filterAcceptsRow(int source_row, const QModelIndex& source_parent) const
+void LogcatFilterProxy::setSourceModel(QAbstractItemModel* source_model)
 {
-    auto contains = [this](const QString& s, int regex_id, int flag_id) {
-        const bool inverted = pattern_.at(flag_id).size() > 0;
-        const bool contains = s.contains(regex_.at(regex_id));
-        return (contains && ! inverted) || (! contains && inverted);
-    };
+    for (const auto& connection : connections_) { disconnect(connection); }
+    connections_.clear();
+    if (job_) {
+        filter_ = std::move(pending_filter_);
+        cancelRefilter();
+    }
 
-    const auto model = sourceModel();
-    const auto pidIndex = model->index(source_row, PID_Column, source_parent);
-    const auto ppidIndex = model->index(source_row, PPID_Column, source_parent);
-    const auto nameIndex = model->index(source_row, NAME_Column, source_parent);
-    const auto priorityIndex = model->index(source_row, PRIORITY_Column, source_parent);
-    const auto tagIndex = model->index(source_row, TAG_Column, source_parent);
+    beginResetModel();
+    accepted_.clear();
+    cache_.clear();
+    QAbstractProxyModel::setSourceModel(source_model);
+    model_ = qobject_cast<LogcatDataModel*>(source_model);
+    if (model_) {
+        connections_ = {
+            connect(model_, &LogcatDataModel::rowsInserted, this, &LogcatFilterProxy::onSourceRowsInserted),
+            connect(model_, &LogcatDataModel::rowsAboutToBeRemoved, this, &LogcatFilterProxy::onSourceRowsAboutToBeRemoved),
+            connect(model_, &LogcatDataModel::dataChanged, this, &LogcatFilterProxy::onSourceDataChanged),
+            connect(model_, &LogcatDataModel::processInfoChanged, this, &LogcatFilterProxy::onProcessInfoChanged),
+            connect(model_, &LogcatDataModel::headerDataChanged, this, &LogcatFilterProxy::headerDataChanged),
+            connect(model_, &LogcatDataModel::modelReset, this, &LogcatFilterProxy::onSourceModelReset),
+            connect(model_, &LogcatDataModel::layoutChanged, this, &LogcatFilterProxy::onSourceModelReset)
+        };
+    }
+    bindFilter();
+    endResetModel();
 
-    if (! contains(model->data(pidIndex).toString(), PID_Regex, PID_Regex_Inverted)) {return false;}
-    if (! contains(model->data(ppidIndex).toString(), PPID_Regex, PPID_Regex_Inverted)) {return false;}
-    if (! contains(model->data(nameIndex).toString(), NAME_Regex, NAME_Regex_Inverted)) {return false;}
-    if (! contains(model->data(priorityIndex).toString(), PRIORITY_Regex, PRIORITY_Regex_Inverted)) {return false;}
-    if (! contains(model->data(tagIndex).toString(), TAG_Regex, TAG_Regex_Inverted)) {return false;}
+    invalidate();
+}
 
-    return true;
+
+QModelIndex LogcatFilterProxy::index(int row, int column, const QModelIndex& parent) const
+{
+    if (parent.isValid() || row < 0 || row >= rowCount() || column < 0 || column >= columnCount()) {
+        return QModelIndex();
+    }
+    return createIndex(row, column);
+}
+
+
+QModelIndex LogcatFilterProxy::parent(const QModelIndex&) const
+{
+    return QModelIndex();
+}
+
+
+int LogcatFilterProxy::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(accepted_.size());
+}
+
+
+int LogcatFilterProxy::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() || ! sourceModel() ? 0 : sourceModel()->columnCount();
+}
+
+
+bool LogcatFilterProxy::hasChildren(const QModelIndex& parent) const
+{
+    return ! parent.isValid() && ! accepted_.empty();
+}
+
+
+QVariant LogcatFilterProxy::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    // the source model has no row headers, so sections are passed through unmapped
+    return sourceModel() ? sourceModel()->headerData(section, orientation, role) : QVariant();
+}
+
+
+QModelIndex LogcatFilterProxy::mapToSource(const QModelIndex& proxy_index) const
+{
+    if (! model_ || ! proxy_index.isValid() || static_cast<size_t>(proxy_index.row()) >= accepted_.size()) {
+        return QModelIndex();
+    }
+    const auto source_row = accepted_[static_cast<size_t>(proxy_index.row())] - firstSeq();
+    return model_->index(static_cast<int>(source_row), proxy_index.column());
+}
+
+
+QModelIndex LogcatFilterProxy::mapFromSource(const QModelIndex& source_index) const
+{
+    if (! model_ || ! source_index.isValid()) { return QModelIndex(); }
+    const auto seq = firstSeq() + static_cast<uint64_t>(source_index.row());
+    auto it = std::lower_bound(accepted_.begin(), accepted_.end(), seq);
+    if (it == accepted_.end() || *it != seq) { return QModelIndex(); }
+    return index(static_cast<int>(it - accepted_.begin()), source_index.column());
 }
 
 
 void LogcatFilterProxy::setFilterPattern(LogcatFilterPattern_t&& pattern)
 {
+    cancelRefilter();
     pattern_ = std::move(pattern);
-    regex_[PID_Regex] = QRegularExpression(pattern_[PID_Regex]);
-    regex_[PPID_Regex] = QRegularExpression(pattern_[PPID_Regex]);
-    regex_[NAME_Regex] = QRegularExpression(pattern_[NAME_Regex]);
-    regex_[PRIORITY_Regex] = QRegularExpression(pattern_[PRIORITY_Regex]);
-    regex_[TAG_Regex] = QRegularExpression(pattern_[TAG_Regex]);
 
+    cacheFilter();
+    if (restoreFilter()) { return; }
+    refilter();
+}
+
+
+void LogcatFilterProxy::refilter()
+{
+    cancelRefilter();
+
+    // a search through the message index, the tag index or within a short time range is
+    // quick enough to run in place
+    auto filter = LogcatFilter(pattern_);
+    if (model_ && ! filter.acceptsAll() && ! LogcatMessageIndex::narrows(filter.messageLiterals())
+            && model_->store().size() >= Min_Background_Rows) {
+        filter.bind(&model_->store(), &model_->processList(), &model_->processStrings());
+        if (estimateRows(filter) >= Min_Background_Rows) {
+            startRefilter(std::move(filter));
+            return;
+        }
+    }
+
+    filter_ = std::move(filter);
+    bindFilter();
     invalidate();
 }
+
+
+void LogcatFilterProxy::invalidate()
+{
+    if (job_) {
+        filter_ = std::move(pending_filter_);
+        cancelRefilter();
+    }
+
+    auto timer = QElapsedTimer();
+    timer.start();
+
+    beginResetModel();
+    accepted_.clear();
+    if (model_) {
+        filter_.resetProcessInfo();
+        const auto& store = model_->store();
+        const auto first_seq = store.firstSeq();
+        auto check = [this, first_seq](uint64_t seq) {
+            if (filter_.accepts(static_cast<size_t>(seq - first_seq))) { accepted_.push_back(seq); }
+        };
+
+        // rows outside of the time range are not looked at
+        const auto range = timeRange(filter_);
+        const auto& index = model_->messageIndex();
+        auto candidates = std::vector<uint64_t>();
+        const auto has_candidates = index.candidates(filter_.messageLiterals(), candidates);
+        const auto indexed_first = std::min(std::max(index.firstSeq(), range.first), range.second);
+        const auto indexed_end = std::max(std::min(index.endSeq(), range.second), indexed_first);
+        if (filter_.usesTagIndex()) {
+            // the tag index selects the rows it covers, the message candidates narrow them down
+            // where the message index covers them too, rows outside of the tag index are scanned
+            const auto& tags = model_->tagIndex();
+            const auto tagged_first = std::min(std::max(tags.firstSeq(), range.first), range.second);
+            const auto tagged_end = std::max(std::min(tags.endSeq(), range.second), tagged_first);
+            auto selected = std::vector<uint64_t>();
+            tags.select(filter_.tagTest(), filter_.indexPriorityMask()).collect(tagged_first, tagged_end, selected);
+
+            for (auto seq = range.first; seq < tagged_first; ++seq) { check(seq); }
+            auto it = candidates.begin();
+            for (auto seq : selected) {
+                if (has_candidates && seq >= indexed_first && seq < indexed_end) {
+                    it = std::lower_bound(it, candidates.end(), seq);
+                    if (it == candidates.end() || *it != seq) { continue; }
+                }
+                if (filter_.acceptsIndexed(static_cast<size_t>(seq - first_seq))) { accepted_.push_back(seq); }
+            }
+            for (auto seq = tagged_end; seq < range.second; ++seq) { check(seq); }
+        } else if (has_candidates) {
+            // only the candidates are verified within the indexed range, rows outside of it are scanned
+            for (auto seq = range.first; seq < indexed_first; ++seq) { check(seq); }
+            for (auto it = std::lower_bound(candidates.begin(), candidates.end(), indexed_first);
+                 it != candidates.end() && *it < indexed_end; ++it) {
+                check(*it);
+            }
+            for (auto seq = indexed_end; seq < range.second; ++seq) { check(seq); }
+        } else {
+            for (auto seq = range.first; seq < range.second; ++seq) { check(seq); }
+        }
+    }
+    endResetModel();
+
+    if (metrics_) { metrics_->filter_ns.record(static_cast<uint64_t>(timer.nsecsElapsed())); }
+}
+
+
+void LogcatFilterProxy::onSourceRowsInserted(const QModelIndex& parent, int first, int last)
+{
+    if (parent.isValid()) { return; }
+
+    const auto first_seq = firstSeq();
+    if (! accepted_.empty() && accepted_.back() >= first_seq + static_cast<uint64_t>(first)) {
+        // not an append, the store only grows at the back
+        invalidate();
+        return;
+    }
+
+    auto timer = QElapsedTimer();
+    timer.start();
+    auto added = std::vector<uint64_t>();
+    for (auto i = static_cast<size_t>(first); i <= static_cast<size_t>(last); ++i) {
+        if (filter_.accepts(i)) { added.push_back(first_seq + i); }
+    }
+    for (auto& entry : cache_) { extendCached(entry); }
+    trimCache();
+    if (metrics_) { metrics_->filter_ns.record(static_cast<uint64_t>(timer.nsecsElapsed())); }
+    if (added.empty()) { return; }
+
+    const auto row = static_cast<int>(accepted_.size());
+    beginInsertRows(QModelIndex(), row, row + static_cast<int>(added.size()) - 1);
+    accepted_.insert(accepted_.end(), added.begin(), added.end());
+    endInsertRows();
+}
+
+
+void LogcatFilterProxy::onSourceRowsAboutToBeRemoved(const QModelIndex& parent, int first, int last)
+{
+    if (parent.isValid()) { return; }
+
+    // the rows are still in the store, so their sequence numbers are known
+    const auto first_seq = firstSeq();
+    for (auto& entry : cache_) { entry.accepted.evictBefore(first_seq + static_cast<uint64_t>(last) + 1); }
+    auto lo = std::lower_bound(accepted_.begin(), accepted_.end(), first_seq + static_cast<uint64_t>(first));
+    auto hi = std::upper_bound(lo, accepted_.end(), first_seq + static_cast<uint64_t>(last));
+    if (lo == hi) { return; }
+
+    const auto row = static_cast<int>(lo - accepted_.begin());
+    beginRemoveRows(QModelIndex(), row, row + static_cast<int>(hi - lo) - 1);
+    accepted_.erase(lo, hi);
+    endRemoveRows();
+}
+
+
+void LogcatFilterProxy::onSourceDataChanged(const QModelIndex& top_left, const QModelIndex& bottom_right, const QVector<int>& roles)
+{
+    if (! top_left.isValid() || ! bottom_right.isValid()) { return; }
+
+    const auto first_seq = firstSeq();
+    auto lo = std::lower_bound(accepted_.begin(), accepted_.end(), first_seq + static_cast<uint64_t>(top_left.row()));
+    auto hi = std::upper_bound(lo, accepted_.end(), first_seq + static_cast<uint64_t>(bottom_right.row()));
+    if (lo == hi) { return; }
+
+    const auto top = static_cast<int>(lo - accepted_.begin());
+    const auto bottom = static_cast<int>(hi - accepted_.begin()) - 1;
+    emit dataChanged(index(top, top_left.column()), index(bottom, bottom_right.column()), roles);
+}
+
+
+void LogcatFilterProxy::onProcessInfoChanged(const std::vector<int>& pids)
+{
+    // a cached filter whose verdict on a process has flipped is filtered anew when it comes back
+    cache_.remove_if([&pids](CachedFilter_t& entry) {
+        return entry.filter.dependsOnProcessInfo() && ! entry.filter.refreshProcessInfo(pids).empty();
+    });
+
+    if (job_) {
+        pending_pids_.insert(pending_pids_.end(), pids.begin(), pids.end());
+    }
+    recheckPids(pids);
+}
+
+
+void LogcatFilterProxy::onSourceModelReset()
+{
+    // the rows are new, e.g. of an opened capture, and dateless time bounds take their date;
+    // nothing of the old rows is shown while a background re-filter runs
+    cache_.clear();
+    cancelRefilter();
+    beginResetModel();
+    accepted_.clear();
+    endResetModel();
+    refilter();
+}
+
+
+void LogcatFilterProxy::setFilterCacheLimit(size_t bytes)
+{
+    cache_limit_ = bytes;
+    trimCache();
+}
+
+
+void LogcatFilterProxy::cacheFilter()
+{
+    if (! model_ || cache_limit_ == 0 || filter_.acceptsAll()) { return; }
+
+    // the filter on display may be cached already when a re-filter was cancelled
+    const auto& pattern = filter_.pattern();
+    cache_.remove_if([&pattern](const CachedFilter_t& entry) { return entry.filter.pattern() == pattern; });
+
+    auto entry = CachedFilter_t();
+    entry.filter = filter_;
+    for (auto seq : accepted_) { entry.accepted.add(seq); }
+    entry.end_seq = model_->store().endSeq();
+    cache_.push_front(std::move(entry));
+    trimCache();
+}
+
+
+bool LogcatFilterProxy::restoreFilter()
+{
+    auto it = std::find_if(cache_.begin(), cache_.end(),
+                           [this](const CachedFilter_t& entry) { return entry.filter.pattern() == pattern_; });
+    if (it == cache_.end()) { return false; }
+
+    auto timer = QElapsedTimer();
+    timer.start();
+
+    auto entry = std::move(*it);
+    cache_.erase(it);
+    extendCached(entry);
+    filter_ = std::move(entry.filter);
+
+    const auto& store = model_->store();
+    auto seqs = std::vector<uint64_t>();
+    entry.accepted.collect(store.firstSeq(), store.endSeq(), seqs);
+    beginResetModel();
+    accepted_.assign(seqs.begin(), seqs.end());
+    endResetModel();
+
+    if (metrics_) { metrics_->filter_ns.record(static_cast<uint64_t>(timer.nsecsElapsed())); }
+    return true;
+}
+
+
+void LogcatFilterProxy::extendCached(CachedFilter_t& entry) const
+{
+    const auto& store = model_->store();
+    const auto first_seq = store.firstSeq();
+    for (auto seq = std::max(entry.end_seq, first_seq); seq < store.endSeq(); ++seq) {
+        if (entry.filter.accepts(static_cast<size_t>(seq - first_seq))) { entry.accepted.add(seq); }
+    }
+    entry.end_seq = store.endSeq();
+}
+
+
+void LogcatFilterProxy::trimCache()
+{
+    size_t bytes = 0;
+    auto it = cache_.begin();
+    for (size_t n = 0; it != cache_.end() && n < Max_Cached_Filters; ++it, ++n) {
+        bytes += it->accepted.memoryUsage();
+        if (bytes > cache_limit_) { break; }
+    }
+    cache_.erase(it, cache_.end());
+}
+
+
+void LogcatFilterProxy::startRefilter(LogcatFilter&& filter)
+{
+    pending_filter_ = std::move(filter);
+    pending_filter_.bind(&model_->store(), &model_->processList(), &model_->processStrings());
+    pending_filter_.setDeviceNames(model_->deviceNames());
+
+    // worker threads must not look into the process table, so every known PID gets its verdict here;
+    // rows of a capture are not tracked per PID, its processes come from the process table alone
+    auto pids = std::vector<int>();
+    pids.reserve(model_->pidRows().size() + model_->processList().size());
+    for (const auto& item : model_->pidRows()) { pids.push_back(item.first); }
+    for (const auto& item : model_->processList()) { pids.push_back(item.first); }
+    pending_filter_.primeProcessInfo(pids);
+
+    auto job = std::make_shared<RefilterJob_t>();
+    job->filter = pending_filter_.detached();
+    job->snapshot = model_->store().sealedSnapshot();
+    job->threads = refilter_threads_ > 0 ? refilter_threads_ : static_cast<int>(std::thread::hardware_concurrency());
+    job_ = job;
+
+    const auto generation = ++job_generation_;
+    job_thread_ = std::thread([this, job, generation]() {
+        if (! filter_snapshot(job->filter, job->snapshot, job->threads, job->cancelled, job->accepted)) { return; }
+        QMetaObject::invokeMethod(this, [this, generation]() { finishRefilter(generation); }, Qt::QueuedConnection);
+    });
+}
+
+
+void LogcatFilterProxy::finishRefilter(uint64_t generation)
+{
+    if (! job_ || generation != job_generation_) { return; }
+
+    job_thread_.join();
+    const auto job = std::move(job_);
+    filter_ = std::move(pending_filter_);
+
+    // rows evicted while the job was running are dropped, rows appended since the snapshot
+    // (and the tail block left out of it) are filtered here
+    const auto& store = model_->store();
+    const auto first_seq = store.firstSeq();
+    auto accepted = std::deque<uint64_t>(
+                std::lower_bound(job->accepted.begin(), job->accepted.end(), first_seq), job->accepted.end());
+    const auto snapshot_end = job->snapshot.first_seq + job->snapshot.size;
+    for (auto seq = std::max(snapshot_end, first_seq); seq < store.endSeq(); ++seq) {
+        if (filter_.accepts(static_cast<size_t>(seq - first_seq))) { accepted.push_back(seq); }
+    }
+
+    beginResetModel();
+    accepted_.swap(accepted);
+    endResetModel();
+
+    const auto pids = std::move(pending_pids_);
+    pending_pids_.clear();
+    recheckPids(pids);
+
+    emit refilterFinished();
+}
+
+
+void LogcatFilterProxy::cancelRefilter()
+{
+    if (job_) { job_->cancelled = true; }
+    if (job_thread_.joinable()) { job_thread_.join(); }
+    job_.reset();
+    pending_pids_.clear();
+}
+
+
+void LogcatFilterProxy::recheckPids(const std::vector<int>& pids)
+{
+    if (! model_ || pids.empty() || ! filter_.dependsOnProcessInfo()) { return; }
+
+    const auto flipped = filter_.refreshProcessInfo(pids);
+    const auto& store = model_->store();
+    if (flipped.empty() || store.empty()) { return; }
+
+    const auto& pid_rows = model_->pidRows();
+    const auto first_seq = store.firstSeq();
+
+    auto added = std::vector<uint64_t>();
+    auto removed = std::vector<uint64_t>();
+    for (auto pid : flipped) {
+        auto rows = pid_rows.find(pid);
+        if (rows == pid_rows.end()) { continue; }
+        // only the rows of the process are visited
+        for (auto seq : rows->second) {
+            if (seq < first_seq) { continue; }
+            const auto accepted = filter_.accepts(static_cast<size_t>(seq - first_seq));
+            const auto present = std::binary_search(accepted_.begin(), accepted_.end(), seq);
+            if (accepted && ! present) {
+                added.push_back(seq);
+            } else if (! accepted && present) {
+                removed.push_back(seq);
+            }
+        }
+    }
+    std::sort(added.begin(), added.end());
+    std::sort(removed.begin(), removed.end());
+    applyChanges(added, removed);
+}
+
+
+void LogcatFilterProxy::bindFilter()
+{
+    if (model_) {
+        filter_.bind(&model_->store(), &model_->processList(), &model_->processStrings());
+        filter_.setDeviceNames(model_->deviceNames());
+    } else {
+        filter_.bind(nullptr, nullptr, nullptr);
+    }
+}
+
+
+std::pair<uint64_t, uint64_t> LogcatFilterProxy::timeRange(const LogcatFilter& filter) const
+{
+    const auto& store = model_->store();
+    auto from = LogcatTimestamp_t();
+    auto to = LogcatTimestamp_t();
+    if (! filter.timeWindow(from, to)) { return {store.firstSeq(), store.endSeq()}; }
+
+    const auto range = model_->timeIndex().range(from, to);
+    const auto first = std::min(std::max(range.first, store.firstSeq()), store.endSeq());
+    return {first, std::max(std::min(range.second, store.endSeq()), first)};
+}
+
+
+size_t LogcatFilterProxy::estimateRows(const LogcatFilter& filter) const
+{
+    const auto range = timeRange(filter);
+    auto rows = static_cast<size_t>(range.second - range.first);
+    if (! filter.usesTagIndex()) { return rows; }
+
+    const auto& tags = model_->tagIndex();
+    const auto tagged_first = std::min(std::max(tags.firstSeq(), range.first), range.second);
+    const auto tagged_end = std::max(std::min(tags.endSeq(), range.second), tagged_first);
+    const auto tagged = static_cast<size_t>(tagged_end - tagged_first);
+    return rows - tagged + std::min(tagged, tags.count(filter.tagTest(), filter.indexPriorityMask()));
+}
+
+
+int LogcatFilterProxy::rowAtOrAfter(int source_row) const
+{
+    const auto seq = firstSeq() + static_cast<uint64_t>(std::max(source_row, 0));
+    return static_cast<int>(std::lower_bound(accepted_.begin(), accepted_.end(), seq) - accepted_.begin());
+}
+
+
+uint64_t LogcatFilterProxy::firstSeq() const
+{
+    return model_ ? model_->store().firstSeq() : 0;
+}
+
+
+void LogcatFilterProxy::applyChanges(const std::vector<uint64_t>& added, const std::vector<uint64_t>& removed)
+{
+    // a few scattered rows are signalled one by one, anything larger is merged under a reset
+    const size_t Max_Row_Signals = 256;
+
+    if (added.size() + removed.size() > Max_Row_Signals) {
+        beginResetModel();
+        auto merged = std::deque<uint64_t>();
+        auto next_removed = removed.begin();
+        auto next_added = added.begin();
+        for (auto seq : accepted_) {
+            while (next_added != added.end() && *next_added < seq) { merged.push_back(*next_added++); }
+            while (next_removed != removed.end() && *next_removed < seq) { ++next_removed; }
+            if (next_removed != removed.end() && *next_removed == seq) { continue; }
+            merged.push_back(seq);
+        }
+        merged.insert(merged.end(), next_added, added.end());
+        accepted_.swap(merged);
+        endResetModel();
+        return;
+    }
+
+    for (auto it = removed.rbegin(); it != removed.rend(); ++it) {
+        auto pos = std::lower_bound(accepted_.begin(), accepted_.end(), *it);
+        const auto row = static_cast<int>(pos - accepted_.begin());
+        beginRemoveRows(QModelIndex(), row, row);
+        accepted_.erase(pos);
+        endRemoveRows();
+    }
+    for (auto seq : added) {
+        auto pos = std::lower_bound(accepted_.begin(), accepted_.end(), seq);
+        const auto row = static_cast<int>(pos - accepted_.begin());
+        beginInsertRows(QModelIndex(), row, row);
+        accepted_.insert(pos, seq);
+        endInsertRows();
+    }
+}
@@ -17,29 +17,40 @@
 #ifndef LOGCATFILTERPROXY_H
 #define LOGCATFILTERPROXY_H
 
-#include <unordered_map>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
 
-#include <QSortFilterProxyModel>
-#include <QRegularExpression>
+#include <QAbstractProxyModel>
 
+#include "logcatfilter.h"
+#include "logcatmetrics.h"
+#include "logcatrowbitmap.h"
 
-const int PID_Regex = 1;
-const int PID_Regex_Inverted = 2;
-const int PRIORITY_Regex = 3;
-const int PRIORITY_Regex_Inverted = 4;
-const int TAG_Regex = 5;
-const int TAG_Regex_Inverted = 6;
-const int NAME_Regex = 7;
-const int NAME_Regex_Inverted = 8;
-const int PPID_Regex = 9;
-const int PPID_Regex_Inverted = 10;
 
+class LogcatDataModel;
 
-using LogcatFilterPattern_t = std::unordered_map<int, QString>;
-using LogcatFilterRegex_t = std::unordered_map<int, QRegularExpression>;
 
-
-class LogcatFilterProxy : public QSortFilterProxyModel
+// Append-optimized filter proxy over LogcatDataModel.
+//
+// The accepted source rows are kept as a sorted list of store sequence numbers, so they
+// stay valid while old rows are evicted from the front. Appended rows are filtered once
+// when they are inserted, a process info update re-checks only the rows of the PIDs whose
+// verdict has changed, and only a new filter pattern or a source model reset re-filters the
+// whole store.
+//
+// A large store is re-filtered by a background job over the sealed store blocks, split
+// across all cores. The view keeps the previous result until the job completes, and a
+// newer filter pattern cancels the job in flight.
+//
+// The last few filters are cached with their accepted rows as bitmaps and keep filtering
+// the appended rows, so switching back to one of them does not re-filter the store.
+class LogcatFilterProxy : public QAbstractProxyModel
 {
     Q_OBJECT
 
@@ -47,15 +58,102 @@ class LogcatFilterProxy : public QSortFilterProxyModel
     LogcatFilterProxy(QObject *parent);
     virtual ~LogcatFilterProxy();
 
-  protected:
-    bool filterAcceptsRow(int source_row, const QModelIndex &source_parent) const override;
+    void setSourceModel(QAbstractItemModel *source_model) override;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    QModelIndex mapToSource(const QModelIndex &proxy_index) const override;
+    QModelIndex mapFromSource(const QModelIndex &source_index) const override;
 
   public:
     void setFilterPattern(LogcatFilterPattern_t&& pattern);
+    // Number of threads of a background re-filter, 0 means one per core.
+    void setRefilterThreads(int threads) { refilter_threads_ = threads; }
+    bool isRefiltering() const { return job_ != nullptr; }
+    // The first accepted row at or after the source row, rowCount() if there is none.
+    int rowAtOrAfter(int source_row) const;
+    // Filtering times of appended rows and in-place re-filters go to `metrics`.
+    void setMetrics(std::shared_ptr<LogcatMetrics> metrics) { metrics_ = std::move(metrics); }
+    // Memory budget of the accepted rows of the cached filters, zero disables the cache.
+    void setFilterCacheLimit(size_t bytes);
+    size_t filterCacheLimit() const { return cache_limit_; }
+
+  signals:
+    void refilterFinished();
+
+  public slots:
+    // Re-filters the whole store.
+    void invalidate();
+
+  protected slots:
+    void onSourceRowsInserted(const QModelIndex &parent, int first, int last);
+    void onSourceRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last);
+    void onSourceDataChanged(const QModelIndex &top_left, const QModelIndex &bottom_right, const QVector<int> &roles);
+    void onProcessInfoChanged(const std::vector<int>& pids);
+    void onSourceModelReset();
+
+  protected:
+    struct RefilterJob_t
+    {
+        LogcatFilter filter;
+        LogcatStoreSnapshot_t snapshot;
+        int threads = 1;
+        std::atomic<bool> cancelled {false};
+        std::vector<uint64_t> accepted;
+    };
+
+    struct CachedFilter_t
+    {
+        LogcatFilter filter;
+        LogcatRowBitmap accepted;
+        uint64_t end_seq = 0;           // the rows before it have been filtered
+    };
+
+    // Stores smaller than this are re-filtered in place.
+    static const size_t Min_Background_Rows = 16 * LogcatStore::Block_Rows;
+    static const size_t Max_Cached_Filters = 8;
+
+    // Filters the whole store with pattern_ anew, in the background if that takes long.
+    void refilter();
+    void startRefilter(LogcatFilter&& filter);
+    void finishRefilter(uint64_t generation);
+    void cancelRefilter();
+    void recheckPids(const std::vector<int>& pids);
+    void bindFilter();
+    uint64_t firstSeq() const;
+    // Sequence numbers [first, end) of the store rows that may pass the time window of `filter`.
+    std::pair<uint64_t, uint64_t> timeRange(const LogcatFilter& filter) const;
+    // Upper bound of the rows an in-place re-filter with `filter` looks at.
+    size_t estimateRows(const LogcatFilter& filter) const;
+    void applyChanges(const std::vector<uint64_t>& added, const std::vector<uint64_t>& removed);
+    // Moves the filter on display to the cache, filters that accept all rows are not worth it.
+    void cacheFilter();
+    // Shows the cached filter of `pattern_`, returns false if there is none.
+    bool restoreFilter();
+    void extendCached(CachedFilter_t& entry) const;
+    void trimCache();
 
   protected:
     LogcatFilterPattern_t pattern_;
-    LogcatFilterRegex_t regex_;
+    LogcatFilter filter_;
+    LogcatDataModel* model_ = nullptr;
+    std::vector<QMetaObject::Connection> connections_;
+    std::deque<uint64_t> accepted_;     // sequence numbers of the accepted rows, ascending
+
+    std::shared_ptr<RefilterJob_t> job_;
+    std::thread job_thread_;
+    uint64_t job_generation_ = 0;
+    LogcatFilter pending_filter_;       // replaces filter_ once the job completes
+    std::vector<int> pending_pids_;     // process info changed while the job was running
+    int refilter_threads_ = 0;
+    std::shared_ptr<LogcatMetrics> metrics_;
+    std::list<CachedFilter_t> cache_;   // most recently used first
+    size_t cache_limit_ = 64 * 1024 * 1024;
 };
 
 
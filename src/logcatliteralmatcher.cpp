@@ -0,0 +1,169 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "logcatliteralmatcher.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LOGCAT_HAVE_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+// AVX2 is compiled per function and selected at run time
+#define LOGCAT_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+static unsigned lowest_bit(uint32_t mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+
+static size_t find_scalar(const char* text, size_t n, const char* needle, size_t m, size_t from)
+{
+    // memchr for the first byte, then compare the rest
+    for (auto i = from; i + m <= n;) {
+        auto p = static_cast<const char*>(std::memchr(text + i, needle[0], n - m + 1 - i));
+        if (! p) { break; }
+        i = static_cast<size_t>(p - text);
+        if (std::memcmp(p + 1, needle + 1, m - 1) == 0) { return i; }
+        i += 1;
+    }
+    return std::string_view::npos;
+}
+
+
+// The kernels compare the first and the last byte of the needle at every position of a
+// vector at once, and only the positions where both match are compared in full.
+
+#ifdef LOGCAT_HAVE_SSE2
+static size_t find_sse2(const char* text, size_t n, const char* needle, size_t m)
+{
+    const auto first = _mm_set1_epi8(needle[0]);
+    const auto last = _mm_set1_epi8(needle[m - 1]);
+    size_t i = 0;
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+        const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i + m - 1));
+        auto mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last))));
+        while (mask != 0) {
+            const auto pos = i + lowest_bit(mask);
+            if (std::memcmp(text + pos + 1, needle + 1, m - 2) == 0) { return pos; }
+            mask &= mask - 1;
+        }
+    }
+    return find_scalar(text, n, needle, m, i);
+}
+#endif
+
+
+#ifdef LOGCAT_HAVE_AVX2
+__attribute__((target("avx2")))
+static size_t find_avx2(const char* text, size_t n, const char* needle, size_t m)
+{
+    const auto first = _mm256_set1_epi8(needle[0]);
+    const auto last = _mm256_set1_epi8(needle[m - 1]);
+    size_t i = 0;
+    for (; i + m - 1 + 32 <= n; i += 32) {
+        const auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+        const auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i + m - 1));
+        auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last))));
+        while (mask != 0) {
+            const auto pos = i + lowest_bit(mask);
+            if (std::memcmp(text + pos + 1, needle + 1, m - 2) == 0) { return pos; }
+            mask &= mask - 1;
+        }
+    }
+    const auto pos = find_sse2(text + i, n - i, needle, m);
+    return pos != std::string_view::npos ? i + pos : pos;
+}
+#endif
+
+
+LogcatSimd_t best_simd()
+{
+    static const auto simd = []() {
+#if defined(LOGCAT_HAVE_AVX2)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) { return LogcatSimd_t::Avx2; }
+#endif
+#if defined(LOGCAT_HAVE_SSE2)
+        return LogcatSimd_t::Sse2;
+#else
+        return LogcatSimd_t::Scalar;
+#endif
+    }();
+    return simd;
+}
+
+
+size_t find_literal(std::string_view text, std::string_view needle, LogcatSimd_t simd)
+{
+    const auto n = text.size();
+    const auto m = needle.size();
+    if (m == 0) { return 0; }
+    if (m > n) { return std::string_view::npos; }
+    if (m == 1) {
+        auto p = static_cast<const char*>(std::memchr(text.data(), needle[0], n));
+        return p ? static_cast<size_t>(p - text.data()) : std::string_view::npos;
+    }
+
+    switch (simd) {
+#ifdef LOGCAT_HAVE_AVX2
+    case LogcatSimd_t::Avx2: return find_avx2(text.data(), n, needle.data(), m);
+#endif
+#ifdef LOGCAT_HAVE_SSE2
+    case LogcatSimd_t::Sse2: return find_sse2(text.data(), n, needle.data(), m);
+#endif
+    default: break;
+    }
+    return find_scalar(text.data(), n, needle.data(), m, 0);
+}
+
+
+LogcatLiteralMatcher::LogcatLiteralMatcher(std::vector<std::string> literals)
+        : literals_(std::move(literals))
+        , simd_(best_simd())
+{
+    // an empty alternative matches any text
+    matches_all_ = std::any_of(literals_.begin(), literals_.end(), [](const std::string& s) { return s.empty(); });
+}
+
+
+bool LogcatLiteralMatcher::contains(std::string_view text) const
+{
+    if (matches_all_) { return true; }
+    for (const auto& literal : literals_) {
+        if (find_literal(text, literal, simd_) != std::string_view::npos) { return true; }
+    }
+    return false;
+}
@@ -0,0 +1,61 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef LOGCATLITERALMATCHER_H
+#define LOGCATLITERALMATCHER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+enum class LogcatSimd_t
+{
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+// Widest instruction set the CPU running the app supports.
+LogcatSimd_t best_simd();
+
+// Position of `needle` in `text`, or std::string_view::npos.
+size_t find_literal(std::string_view text, std::string_view needle, LogcatSimd_t simd = best_simd());
+
+
+// Plain literal or an alternation of literals, matched on raw UTF-8 bytes. A UTF-8 byte
+// sequence occurs in a text exactly where the code points it encodes occur, so this
+// agrees with a case-sensitive regex over the decoded text.
+class LogcatLiteralMatcher
+{
+  public:
+    LogcatLiteralMatcher() = default;
+    explicit LogcatLiteralMatcher(std::vector<std::string> literals);
+
+    bool contains(std::string_view text) const;
+
+    const std::vector<std::string>& literals() const { return literals_; }
+
+  private:
+    std::vector<std::string> literals_;
+    bool matches_all_ = false;
+    LogcatSimd_t simd_ = LogcatSimd_t::Scalar;
+};
+
+
+#endif // LOGCATLITERALMATCHER_H
@@ -0,0 +1,167 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "pch.h"
+#include "logcatmerger.h"
+
+#include <functional>
+#include <limits>
+#include <queue>
+
+
+LogcatMerger::LogcatMerger(const std::vector<LogcatBatchQueue*>& inputs, size_t queue_capacity)
+        : queue_(queue_capacity)
+        , free_(queue_capacity)
+{
+    inputs_.resize(inputs.size());
+    for (size_t i = 0; i < inputs.size(); ++i) { inputs_[i].queue = inputs[i]; }
+}
+
+
+LogcatMerger::~LogcatMerger()
+{}
+
+
+bool LogcatMerger::pop(Batch_t& batch)
+{
+    return queue_.pop(batch);
+}
+
+
+void LogcatMerger::recycle(Batch_t&& batch)
+{
+    batch->clear();
+    free_.push(std::move(batch));  // dropped if the free list is full
+}
+
+
+void LogcatMerger::start()
+{
+    if (! timer_) {
+        timer_ = new QTimer(this);
+        connect(timer_, &QTimer::timeout, this, &LogcatMerger::step);
+    }
+    clock_.start();
+    timer_->start(Poll_Msecs);
+}
+
+
+void LogcatMerger::stop()
+{
+    if (timer_) { timer_->stop(); }
+}
+
+
+void LogcatMerger::step()
+{
+    flushHeld();
+    if (! held_.empty()) { return; }  // the consumer is behind
+
+    const auto now = clock_.elapsed();
+    for (auto& input : inputs_) {
+        auto batch = Batch_t();
+        while (input.queue->pop(batch)) {
+            if (batch->rows.empty()) {
+                input.queue->recycle(std::move(batch));
+                continue;
+            }
+            input.batches.push_back(std::move(batch));
+            input.arrivals.push_back(now);
+        }
+    }
+
+    // an input without pending rows can still deliver rows from its last timestamp on
+    auto watermark = std::numeric_limits<LogcatTimestamp_t>::max();
+    using Head_t = std::pair<LogcatTimestamp_t, size_t>;
+    auto heads = std::priority_queue<Head_t, std::vector<Head_t>, std::greater<Head_t>>();
+    for (size_t i = 0; i < inputs_.size(); ++i) {
+        const auto& input = inputs_[i];
+        if (! input.empty()) {
+            heads.push({input.head().timestamp, i});
+        } else {
+            watermark = std::min(watermark, input.started ? input.last : std::numeric_limits<LogcatTimestamp_t>::min());
+        }
+    }
+
+    while (! heads.empty()) {
+        const auto [timestamp, i] = heads.top();
+        auto& input = inputs_[i];
+        if (timestamp > watermark && now - input.arrivals.front() < Hold_Msecs) { break; }
+
+        heads.pop();
+        take(input);
+        if (! input.empty()) {
+            heads.push({input.head().timestamp, i});
+        } else {
+            watermark = std::min(watermark, input.last);
+        }
+        if (! held_.empty()) { break; }
+    }
+
+    // publish what we have, so that a quiet stream still shows up promptly
+    sealCurrent();
+    flushHeld();
+}
+
+
+void LogcatMerger::take(Input_t& input)
+{
+    if (! current_) {
+        if (! free_.pop(current_)) {
+            current_ = std::make_unique<LogcatBatch_t>();
+            current_->rows.reserve(LogcatReader::Batch_Rows);
+            current_->bytes.reserve(LogcatReader::Batch_Bytes + 8192);
+        }
+    }
+
+    const auto& batch = *input.batches.front();
+    const auto& row = batch.rows[input.pos];
+    auto r = row;
+    r.offset = static_cast<uint32_t>(current_->bytes.size());
+    current_->bytes.insert(current_->bytes.end(), batch.bytes.data() + row.offset, batch.bytes.data() + row.offset + row.size);
+    current_->rows.push_back(r);
+    input.last = row.timestamp;
+    input.started = true;
+
+    if (++input.pos == batch.rows.size()) {
+        input.queue->recycle(std::move(input.batches.front()));
+        input.batches.pop_front();
+        input.arrivals.pop_front();
+        input.pos = 0;
+    }
+
+    if (current_->rows.size() >= LogcatReader::Batch_Rows || current_->bytes.size() >= LogcatReader::Batch_Bytes) {
+        sealCurrent();
+        flushHeld();
+    }
+}
+
+
+void LogcatMerger::sealCurrent()
+{
+    if (! current_ || current_->rows.empty()) { return; }
+    held_.push_back(std::move(current_));
+}
+
+
+void LogcatMerger::flushHeld()
+{
+    while (! held_.empty()) {
+        if (! queue_.push(std::move(held_.front()))) { return; }
+        held_.pop_front();
+    }
+}
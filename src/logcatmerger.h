@@ -0,0 +1,91 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef LOGCATMERGER_H
+#define LOGCATMERGER_H
+
+#include <deque>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+#include "logcatreader.h"
+#include "logcatspscqueue.h"
+
+
+// K-way merge of the batches of several readers into one stream ordered by timestamp, on
+// its own thread. The rows of each input are taken in their original order.
+//
+// A row is released once no input can deliver an earlier one: every other input either has
+// rows pending or has already delivered a later row. Otherwise it is held back for up to
+// Hold_Msecs, so a quiet device delays the others by that much at most. Nothing is dropped,
+// while the consumer is behind the inputs are not read and the readers apply their own
+// backpressure.
+class LogcatMerger : public QObject, public LogcatBatchQueue
+{
+    Q_OBJECT
+
+  public:
+    static const int Hold_Msecs = 250;
+    static const int Poll_Msecs = 5;
+
+    explicit LogcatMerger(const std::vector<LogcatBatchQueue*>& inputs, size_t queue_capacity = 64);
+    virtual ~LogcatMerger();
+
+    // Consumer (GUI thread) side.
+    bool pop(Batch_t& batch) override;
+    void recycle(Batch_t&& batch) override;
+
+  public slots:
+    void start();
+    void stop();
+
+  private slots:
+    void step();
+
+  private:
+    struct Input_t
+    {
+        LogcatBatchQueue* queue = nullptr;
+        std::deque<Batch_t> batches;
+        std::deque<qint64> arrivals;    // when each of the batches was taken from the queue
+        size_t pos = 0;                 // next row of the front batch
+        LogcatTimestamp_t last = 0;     // timestamp of the last row taken
+        bool started = false;
+
+        bool empty() const { return batches.empty(); }
+        const LogcatRow_t& head() const { return batches.front()->rows[pos]; }
+    };
+
+    void take(Input_t& input);
+    void sealCurrent();
+    void flushHeld();
+
+  private:
+    std::vector<Input_t> inputs_;
+    QTimer* timer_ = nullptr;
+    QElapsedTimer clock_;
+    Batch_t current_;
+    std::deque<Batch_t> held_;          // merged batches waiting for space in queue_
+    LogcatSpscQueue<Batch_t> queue_;
+    LogcatSpscQueue<Batch_t> free_;
+};
+
+
+#endif // LOGCATMERGER_H
@@ -0,0 +1,263 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "logcatmessageindex.h"
+
+#include <algorithm>
+#include <iterator>
+
+
+// Trigrams are 24 bits wide, so this never collides with a real key.
+static const uint32_t Empty_Slot = ~0u;
+// Rough per-entry cost of the open segment table: slots at half load and the vector header.
+static const size_t Open_Entry_Bytes = 48;
+
+
+static char fold(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+
+void LogcatMessageIndex::trigrams(std::string_view text, std::vector<Trigram_t>& out)
+{
+    out.clear();
+    if (text.size() < 3) { return; }
+    auto key = (Trigram_t(static_cast<uint8_t>(fold(text[0]))) << 8) | static_cast<uint8_t>(fold(text[1]));
+    for (size_t i = 2; i < text.size(); ++i) {
+        key = ((key << 8) | static_cast<uint8_t>(fold(text[i]))) & 0xffffff;
+        out.push_back(key);
+    }
+}
+
+
+size_t LogcatMessageIndex::Segment_t::slot(Trigram_t key) const
+{
+    const auto mask = slots.size() - 1;
+    auto i = (key * 0x9e3779b1u) & mask;
+    while (slots[i] != key && slots[i] != Empty_Slot) { i = (i + 1) & mask; }
+    return i;
+}
+
+
+LogcatMessageIndex::Postings_t& LogcatMessageIndex::Segment_t::openList(Trigram_t key)
+{
+    if ((lists.size() + 1) * 2 > slots.size()) {
+        // keep the load under one half
+        slots.assign(std::max<size_t>(1024, slots.size() * 2), Empty_Slot);
+        slot_lists.resize(slots.size());
+        for (size_t n = 0; n < lists.size(); ++n) {
+            const auto i = slot(keys[n]);
+            slots[i] = keys[n];
+            slot_lists[i] = static_cast<uint32_t>(n);
+        }
+    }
+    const auto i = slot(key);
+    if (slots[i] == Empty_Slot) {
+        slots[i] = key;
+        slot_lists[i] = static_cast<uint32_t>(lists.size());
+        keys.push_back(key);
+        lists.emplace_back();
+    }
+    return lists[slot_lists[i]];
+}
+
+
+const uint16_t* LogcatMessageIndex::Segment_t::find(Trigram_t key, size_t& count) const
+{
+    if (! sealed) {
+        const auto i = slots.empty() ? 0 : slot(key);
+        count = slots.empty() || slots[i] == Empty_Slot ? 0 : lists[slot_lists[i]].size();
+        return count ? lists[slot_lists[i]].data() : nullptr;
+    }
+    auto it = std::lower_bound(keys.begin(), keys.end(), key);
+    if (it == keys.end() || *it != key) {
+        count = 0;
+        return nullptr;
+    }
+    const auto i = static_cast<size_t>(it - keys.begin());
+    count = starts[i + 1] - starts[i];
+    return postings.data() + starts[i];
+}
+
+
+void LogcatMessageIndex::setMemoryLimit(size_t bytes)
+{
+    memory_limit_ = bytes;
+    applyMemoryLimit();
+}
+
+
+void LogcatMessageIndex::append(uint64_t seq, std::string_view message)
+{
+    if (seq != end_seq_) {
+        // not consecutive, start over from this row
+        clear();
+        first_seq_ = seq;
+        end_seq_ = seq;
+    }
+
+    if (segments_.empty() || segments_.back()->rows == Segment_Rows) {
+        if (! segments_.empty()) { seal(*segments_.back()); }
+        auto segment = std::make_unique<Segment_t>();
+        segment->first_seq = seq;
+        segments_.push_back(std::move(segment));
+        applyMemoryLimit();
+    }
+
+    auto& segment = *segments_.back();
+    const auto offset = static_cast<uint16_t>(segment.rows);
+    trigrams(message, scratch_);
+    for (auto key : scratch_) {
+        auto& postings = segment.openList(key);
+        if (! postings.empty() && postings.back() == offset) { continue; }
+        if (postings.empty()) {
+            segment.memory += Open_Entry_Bytes;
+            memory_usage_ += Open_Entry_Bytes;
+        }
+        if (postings.size() == postings.capacity()) {
+            const auto grown = std::max<size_t>(4, postings.capacity() * 2);
+            segment.memory += (grown - postings.capacity()) * sizeof(uint16_t);
+            memory_usage_ += (grown - postings.capacity()) * sizeof(uint16_t);
+            postings.reserve(grown);
+        }
+        postings.push_back(offset);
+    }
+    segment.rows += 1;
+    end_seq_ += 1;
+}
+
+
+void LogcatMessageIndex::seal(Segment_t& segment)
+{
+    // `keys` of an open segment are in insertion order, they index `lists`
+    auto order = std::vector<uint32_t>(segment.keys.size());
+    size_t total = 0;
+    for (size_t n = 0; n < order.size(); ++n) {
+        order[n] = static_cast<uint32_t>(n);
+        total += segment.lists[n].size();
+    }
+    std::sort(order.begin(), order.end(), [&segment](uint32_t a, uint32_t b) { return segment.keys[a] < segment.keys[b]; });
+
+    auto keys = std::vector<Trigram_t>();
+    keys.reserve(order.size());
+    segment.starts.reserve(order.size() + 1);
+    segment.postings.reserve(total);
+    for (auto n : order) {
+        const auto& postings = segment.lists[n];
+        keys.push_back(segment.keys[n]);
+        segment.starts.push_back(static_cast<uint32_t>(segment.postings.size()));
+        segment.postings.insert(segment.postings.end(), postings.begin(), postings.end());
+    }
+    segment.starts.push_back(static_cast<uint32_t>(segment.postings.size()));
+    segment.keys = std::move(keys);
+    segment.slots = {};
+    segment.slot_lists = {};
+    segment.lists = {};
+    segment.sealed = true;
+
+    memory_usage_ -= segment.memory;
+    segment.memory = segment.keys.size() * sizeof(Trigram_t) + segment.starts.size() * sizeof(uint32_t)
+            + segment.postings.size() * sizeof(uint16_t);
+    memory_usage_ += segment.memory;
+}
+
+
+void LogcatMessageIndex::evictBefore(uint64_t seq)
+{
+    while (! segments_.empty() && segments_.front()->first_seq + segments_.front()->rows <= seq
+           && segments_.front()->rows == Segment_Rows) {
+        dropFront();
+    }
+}
+
+
+void LogcatMessageIndex::clear()
+{
+    segments_.clear();
+    first_seq_ = end_seq_;
+    memory_usage_ = 0;
+}
+
+
+void LogcatMessageIndex::dropFront()
+{
+    memory_usage_ -= segments_.front()->memory;
+    segments_.pop_front();
+    first_seq_ = segments_.empty() ? end_seq_ : segments_.front()->first_seq;
+}
+
+
+void LogcatMessageIndex::applyMemoryLimit()
+{
+    // the open segment is always kept, rows only become unindexed a segment at a time
+    while (memory_limit_ > 0 && memory_usage_ > memory_limit_ && segments_.size() > 1) {
+        dropFront();
+    }
+}
+
+
+bool LogcatMessageIndex::narrows(const std::vector<std::string>& literals)
+{
+    return std::any_of(literals.begin(), literals.end(), [](const std::string& literal) { return literal.size() >= 3; });
+}
+
+
+bool LogcatMessageIndex::candidates(const std::vector<std::string>& literals, std::vector<uint64_t>& seqs) const
+{
+    seqs.clear();
+
+    auto keys = std::vector<Trigram_t>();
+    auto literal_keys = std::vector<Trigram_t>();
+    for (const auto& literal : literals) {
+        trigrams(literal, literal_keys);
+        keys.insert(keys.end(), literal_keys.begin(), literal_keys.end());
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    if (keys.empty()) { return false; }
+
+    struct List_t
+    {
+        const uint16_t* data;
+        size_t count;
+    };
+    auto lists = std::vector<List_t>(keys.size());
+    auto matches = std::vector<uint16_t>();
+    auto next = std::vector<uint16_t>();
+
+    for (const auto& segment : segments_) {
+        bool empty = false;
+        for (size_t i = 0; i < keys.size() && ! empty; ++i) {
+            lists[i].data = segment->find(keys[i], lists[i].count);
+            empty = lists[i].count == 0;
+        }
+        if (empty) { continue; }
+
+        // intersect starting from the shortest list
+        std::sort(lists.begin(), lists.end(), [](const List_t& a, const List_t& b) { return a.count < b.count; });
+        matches.assign(lists[0].data, lists[0].data + lists[0].count);
+        for (size_t i = 1; i < lists.size() && ! matches.empty(); ++i) {
+            next.clear();
+            std::set_intersection(matches.begin(), matches.end(), lists[i].data, lists[i].data + lists[i].count,
+                                  std::back_inserter(next));
+            matches.swap(next);
+        }
+        for (auto offset : matches) { seqs.push_back(segment->first_seq + offset); }
+    }
+    return true;
+}
@@ -0,0 +1,103 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef LOGCATMESSAGEINDEX_H
+#define LOGCATMESSAGEINDEX_H
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// Trigram index over the message text of consecutive store rows.
+//
+// Rows are grouped into segments of Segment_Rows, each segment maps a trigram to the
+// sorted list of row offsets within the segment, so a posting costs two bytes. The open
+// segment is filled as rows are appended and is compacted into flat sorted arrays once
+// it is full. Trigrams are taken over ASCII-lowercased bytes, so a lookup returns a
+// superset of the rows that match case-sensitively or not.
+//
+// The oldest segments are dropped on eviction and whenever the memory limit is exceeded,
+// the rows before firstSeq() are then not covered and have to be scanned.
+class LogcatMessageIndex
+{
+  public:
+    static const size_t Segment_Rows = 65536;
+
+    // Zero means no limit.
+    void setMemoryLimit(size_t bytes);
+    size_t memoryLimit() const { return memory_limit_; }
+
+    // Rows have to be appended with consecutive sequence numbers.
+    void append(uint64_t seq, std::string_view message);
+    // Drops the segments that only hold rows before `seq`.
+    void evictBefore(uint64_t seq);
+    void clear();
+
+    uint64_t firstSeq() const { return first_seq_; }
+    uint64_t endSeq() const { return end_seq_; }
+    size_t memoryUsage() const { return memory_usage_; }
+
+    // Indexed rows that may contain all of `literals`, in ascending order. Returns false if
+    // none of the literals is long enough to narrow the search, `seqs` is left empty then.
+    bool candidates(const std::vector<std::string>& literals, std::vector<uint64_t>& seqs) const;
+    static bool narrows(const std::vector<std::string>& literals);
+
+  private:
+    using Trigram_t = uint32_t;
+    using Postings_t = std::vector<uint16_t>;
+
+    struct Segment_t
+    {
+        uint64_t first_seq = 0;
+        size_t rows = 0;
+        bool sealed = false;
+        // open segment: open addressing table from a trigram to its postings in `lists`
+        std::vector<Trigram_t> slots;
+        std::vector<uint32_t> slot_lists;
+        std::vector<Postings_t> lists;
+        // sealed segment: postings of keys[i] are postings[starts[i]] .. postings[starts[i + 1]],
+        // keys of an open segment are in insertion order and keys[i] owns lists[i]
+        std::vector<Trigram_t> keys;
+        std::vector<uint32_t> starts;
+        std::vector<uint16_t> postings;
+        size_t memory = 0;
+
+        const uint16_t* find(Trigram_t key, size_t& count) const;
+        size_t slot(Trigram_t key) const;
+        Postings_t& openList(Trigram_t key);
+    };
+
+    static void trigrams(std::string_view text, std::vector<Trigram_t>& out);
+    void seal(Segment_t& segment);
+    void dropFront();
+    void applyMemoryLimit();
+
+  private:
+    std::deque<std::unique_ptr<Segment_t>> segments_;
+    uint64_t first_seq_ = 0;
+    uint64_t end_seq_ = 0;
+    size_t memory_usage_ = 0;
+    size_t memory_limit_ = 0;
+    std::vector<Trigram_t> scratch_;
+};
+
+
+#endif // LOGCATMESSAGEINDEX_H
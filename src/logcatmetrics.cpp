@@ -0,0 +1,155 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "logcatmetrics.h"
+
+#include <algorithm>
+#include <cstdio>
+
+
+uint64_t LogcatHistogramSnapshot_t::quantile(double q) const
+{
+    if (count == 0) { return 0; }
+
+    const auto rank = static_cast<uint64_t>(q * static_cast<double>(count - 1));
+    uint64_t seen = 0;
+    for (int b = 0; b < Bucket_Count; ++b) {
+        seen += buckets[b];
+        if (seen > rank) {
+            const auto upper = b == 0 ? uint64_t(0) : (uint64_t(1) << b) - 1;
+            return std::min(upper, max);
+        }
+    }
+    return max;
+}
+
+
+static int bucket_of(uint64_t value)
+{
+    int b = 0;
+    while (value != 0 && b < LogcatHistogramSnapshot_t::Bucket_Count - 1) {
+        value >>= 1;
+        b += 1;
+    }
+    return b;
+}
+
+
+void LogcatHistogram::record(uint64_t value)
+{
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    buckets_[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+
+    auto max = max_.load(std::memory_order_relaxed);
+    while (value > max && ! max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+}
+
+
+LogcatHistogramSnapshot_t LogcatHistogram::snapshot() const
+{
+    auto s = LogcatHistogramSnapshot_t();
+    for (int b = 0; b < LogcatHistogramSnapshot_t::Bucket_Count; ++b) {
+        s.buckets[b] = buckets_[b].load(std::memory_order_relaxed);
+        s.count += s.buckets[b];
+    }
+    s.sum = sum_.load(std::memory_order_relaxed);
+    s.max = max_.load(std::memory_order_relaxed);
+    return s;
+}
+
+
+void LogcatHistogram::reset()
+{
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+    for (auto& b : buckets_) { b.store(0, std::memory_order_relaxed); }
+}
+
+
+void LogcatMetrics::reset()
+{
+    for (auto h : {&read_bytes, &parse_ns_per_line, &insert_rows, &insert_ns, &filter_ns, &ps_msecs, &cell_ns}) {
+        h->reset();
+    }
+}
+
+
+static std::string format_number(double value)
+{
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%.6g", value);
+    return buf;
+}
+
+
+static std::string json_string(const std::string& s)
+{
+    auto out = std::string("\"");
+    for (const auto c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+
+std::string metrics_to_json(const LogcatMetricList_t& metrics)
+{
+    auto out = std::string("{\n");
+    for (size_t i = 0; i < metrics.size(); ++i) {
+        const auto& m = metrics[i];
+        out += "  " + json_string(m.name) + ": {\"unit\": " + json_string(m.unit);
+        if (m.is_histogram) {
+            const auto& h = m.histogram;
+            out += ", \"count\": " + std::to_string(h.count)
+                    + ", \"mean\": " + format_number(h.mean())
+                    + ", \"p50\": " + std::to_string(h.quantile(0.50))
+                    + ", \"p90\": " + std::to_string(h.quantile(0.90))
+                    + ", \"p99\": " + std::to_string(h.quantile(0.99))
+                    + ", \"max\": " + std::to_string(h.max) + "}";
+        } else {
+            out += ", \"value\": " + format_number(m.value) + "}";
+        }
+        out += i + 1 < metrics.size() ? ",\n" : "\n";
+    }
+    return out + "}\n";
+}
+
+
+std::string metrics_to_csv(const LogcatMetricList_t& metrics)
+{
+    auto out = std::string("name,unit,value,count,mean,p50,p90,p99,max\n");
+    for (const auto& m : metrics) {
+        out += m.name + "," + m.unit + ",";
+        if (m.is_histogram) {
+            const auto& h = m.histogram;
+            out += "," + std::to_string(h.count) + "," + format_number(h.mean())
+                    + "," + std::to_string(h.quantile(0.50)) + "," + std::to_string(h.quantile(0.90))
+                    + "," + std::to_string(h.quantile(0.99)) + "," + std::to_string(h.max) + "\n";
+        } else {
+            out += format_number(m.value) + ",,,,,,\n";
+        }
+    }
+    return out;
+}
@@ -0,0 +1,91 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef LOGCATMETRICS_H
+#define LOGCATMETRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+struct LogcatHistogramSnapshot_t
+{
+    static const int Bucket_Count = 64;
+
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    uint64_t buckets[Bucket_Count] = {};    // bucket b counts values in [2^(b-1), 2^b)
+
+    double mean() const { return count > 0 ? static_cast<double>(sum) / count : 0.0; }
+    // Upper bound of the bucket holding the q-quantile, q in [0, 1].
+    uint64_t quantile(double q) const;
+};
+
+
+// Distribution of a latency or a size in power-of-two buckets. record() is a handful of
+// relaxed atomic adds, so any thread may record while another one takes snapshots.
+class LogcatHistogram
+{
+  public:
+    void record(uint64_t value);
+    LogcatHistogramSnapshot_t snapshot() const;
+    void reset();
+
+  private:
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+    std::atomic<uint64_t> buckets_[LogcatHistogramSnapshot_t::Bucket_Count] = {};
+};
+
+
+// Per-stage distributions, shared by the components of a capture.
+struct LogcatMetrics
+{
+    LogcatHistogram read_bytes;         // size of each read from the logcat pipe
+    LogcatHistogram parse_ns_per_line;  // decoding time per row, averaged over a read
+    LogcatHistogram insert_rows;        // rows committed to the store per event-loop turn
+    LogcatHistogram insert_ns;          // time of such a turn, index and retention included
+    LogcatHistogram filter_ns;          // filtering appended rows or re-filtering in place
+    LogcatHistogram ps_msecs;           // run time of a process list refresh
+    LogcatHistogram cell_ns;            // formatting a cell the display cache did not have
+
+    void reset();
+};
+
+
+// A line of a metrics report: `value` of a counter or gauge, or the histogram.
+struct LogcatMetric_t
+{
+    std::string name;
+    std::string unit;
+    double value = 0.0;
+    bool is_histogram = false;
+    LogcatHistogramSnapshot_t histogram;
+};
+
+using LogcatMetricList_t = std::vector<LogcatMetric_t>;
+
+// A JSON object with a member per metric, an object with the unit and either the value or
+// count, mean, p50, p90, p99 and max of the histogram.
+std::string metrics_to_json(const LogcatMetricList_t& metrics);
+// A header line and a line per metric: name,unit,value,count,mean,p50,p90,p99,max.
+std::string metrics_to_csv(const LogcatMetricList_t& metrics);
+
+
+#endif // LOGCATMETRICS_H
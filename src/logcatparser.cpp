@@ -0,0 +1,261 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "logcatparser.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+
+namespace {
+
+inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+inline bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f'; }
+inline bool is_word(char c) { return is_digit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; }
+
+
+struct Scanner
+{
+    const char* begin;
+    const char* p;
+    const char* end;
+
+    ptrdiff_t pos() const { return p - begin; }
+
+    bool number(int& value, int max_digits = 9)
+    {
+        const auto start = p;
+        int v = 0;
+        while (p < end && is_digit(*p)) {
+            if (p - start == max_digits) { return false; }
+            v = v * 10 + (*p - '0');
+            ++p;
+        }
+        value = v;
+        return p != start;
+    }
+
+    // fractional part of seconds, scaled to nanoseconds
+    bool fraction(int& nsec)
+    {
+        const auto start = p;
+        int v = 0;
+        int scale = 1000000000;
+        while (p < end && is_digit(*p)) {
+            if (scale > 1) {
+                scale /= 10;
+                v += (*p - '0') * scale;
+            }
+            ++p;
+        }
+        nsec = v;
+        return p != start;
+    }
+
+    bool spaces()
+    {
+        const auto start = p;
+        while (p < end && is_space(*p)) { ++p; }
+        return p != start;
+    }
+
+    bool word()
+    {
+        const auto start = p;
+        while (p < end && is_word(*p)) { ++p; }
+        return p != start;
+    }
+
+    bool expect(char c)
+    {
+        if (p < end && *p == c) {
+            ++p;
+            return true;
+        }
+        return false;
+    }
+};
+
+
+template<typename T>
+inline bool fits(ptrdiff_t value)
+{
+    return value >= 0 && value <= static_cast<ptrdiff_t>(std::numeric_limits<T>::max());
+}
+
+} // namespace
+
+
+LogcatPriority_t priority_from_char(char c)
+{
+    switch (c) {
+    case 'V': return LogcatPriority_t::Verbose;
+    case 'D': return LogcatPriority_t::Debug;
+    case 'I': return LogcatPriority_t::Info;
+    case 'W': return LogcatPriority_t::Warning;
+    case 'E': return LogcatPriority_t::Error;
+    case 'F': return LogcatPriority_t::Fatal;
+    case 'S': return LogcatPriority_t::Silent;
+    }
+    return LogcatPriority_t::Unknown;
+}
+
+
+char priority_to_char(LogcatPriority_t p)
+{
+    static const char chars[] = "?VDIWEFS";
+    const auto i = static_cast<size_t>(p);
+    return i < sizeof(chars) - 1 ? chars[i] : '?';
+}
+
+
+bool parse_threadtime_line(const char* line, ptrdiff_t size, LogcatRow_t& row)
+{
+    auto s = Scanner{line, line, line + size};
+    ptrdiff_t start;
+    int month, day, hour, minute, second, nsec;
+
+    // date
+    if (! (s.number(month, 2) && s.expect('-') && s.number(day, 2))) { return false; }
+    if (! fits<uint8_t>(s.pos())) { return false; }
+    row.date_size = static_cast<uint8_t>(s.pos());
+    if (! s.spaces()) { return false; }
+
+    // time
+    start = s.pos();
+    if (! (s.number(hour, 2) && s.expect(':') && s.number(minute, 2) && s.expect(':') && s.number(second, 2)
+           && s.expect('.') && s.fraction(nsec))) {
+        return false;
+    }
+    if (! (fits<uint8_t>(start) && fits<uint8_t>(s.pos() - start))) { return false; }
+    row.time_offset = static_cast<uint8_t>(start);
+    row.time_size = static_cast<uint8_t>(s.pos() - start);
+    row.timestamp = pack_timestamp(month, day, hour, minute, second, nsec);
+    if (! s.spaces()) { return false; }
+
+    // pid
+    if (! s.number(row.pid)) { return false; }
+    if (! s.spaces()) { return false; }
+
+    // tid
+    if (! s.number(row.tid)) { return false; }
+    if (! s.spaces()) { return false; }
+
+    // priority
+    start = s.pos();
+    if (! s.word()) { return false; }
+    if (! (fits<uint8_t>(start) && fits<uint8_t>(s.pos() - start))) { return false; }
+    row.priority_offset = static_cast<uint8_t>(start);
+    row.priority_size = static_cast<uint8_t>(s.pos() - start);
+    row.priority = row.priority_size == 1 ? priority_from_char(line[start]) : LogcatPriority_t::Unknown;
+    if (! s.spaces()) { return false; }
+
+    // tag: everything up to the first ':', trailing spaces trimmed
+    start = s.pos();
+    while (s.p < s.end && *s.p != ':') { ++s.p; }
+    if (s.p == s.end) { return false; }
+    auto tag_end = s.p;
+    while (tag_end > line + start && is_space(tag_end[-1])) { --tag_end; }
+    if (tag_end == line + start) { return false; }
+    if (! (fits<uint16_t>(start) && fits<uint16_t>(tag_end - line - start))) { return false; }
+    row.tag_offset = static_cast<uint16_t>(start);
+    row.tag_size = static_cast<uint16_t>(tag_end - line - start);
+    ++s.p;
+
+    // message: a single separator space is required, the message itself may be empty
+    if (s.p < s.end && is_space(*s.p)) {
+        ++s.p;
+    } else if (s.p != s.end) {
+        return false;
+    }
+    auto msg_end = s.end;
+    while (msg_end > s.p && (msg_end[-1] == '\r' || msg_end[-1] == '\n')) { --msg_end; }
+    if (! (fits<uint16_t>(s.pos()) && fits<uint32_t>(msg_end - line))) { return false; }
+    row.message_offset = static_cast<uint16_t>(s.pos());
+    row.size = static_cast<uint32_t>(msg_end - line);
+    return true;
+}
+
+
+std::vector<size_t> split_lines(const char* data, size_t size, size_t chunk_bytes)
+{
+    auto ends = std::vector<size_t>();
+    size_t pos = 0;
+    while (size - pos > chunk_bytes) {
+        const auto from = pos + chunk_bytes;
+        const auto eol = static_cast<const char*>(std::memchr(data + from, '\n', size - from));
+        if (! eol) { break; }
+        pos = eol - data + 1;
+        ends.push_back(pos);
+    }
+    if (pos < size) { ends.push_back(size); }
+    return ends;
+}
+
+
+void parse_lines(const char* data, size_t size, size_t batch_rows, size_t batch_bytes, LogcatBatchList_t& batches)
+{
+    auto batch = static_cast<LogcatBatch_t*>(nullptr);
+    size_t pos = 0;
+
+    while (pos < size) {
+        auto eol = static_cast<const char*>(std::memchr(data + pos, '\n', size - pos));
+        if (! eol) { eol = data + size; }
+        const auto line = data + pos;
+        pos = eol - data + 1;
+
+        auto row = LogcatRow_t();
+        if (! parse_threadtime_line(line, eol - line, row)) { continue; }
+
+        if (! batch || batch->rows.size() >= batch_rows || batch->bytes.size() >= batch_bytes) {
+            batches.push_back(std::make_unique<LogcatBatch_t>());
+            batch = batches.back().get();
+            batch->rows.reserve(batch_rows);
+            batch->bytes.reserve(batch_bytes + 8192);
+        }
+        row.offset = static_cast<uint32_t>(batch->bytes.size());
+        batch->bytes.insert(batch->bytes.end(), line, line + row.size);
+        batch->rows.push_back(row);
+    }
+}
+
+
+void parse_chunks(const char* data, size_t begin, const std::vector<size_t>& ends, int threads,
+                  size_t batch_rows, size_t batch_bytes, std::vector<LogcatBatchList_t>& out)
+{
+    out.clear();
+    out.resize(ends.size());
+
+    auto next_chunk = std::atomic<size_t>(0);
+    auto worker = [&]() {
+        for (;;) {
+            const auto i = next_chunk.fetch_add(1, std::memory_order_relaxed);
+            if (i >= ends.size()) { return; }
+            const auto from = i == 0 ? begin : ends[i - 1];
+            parse_lines(data + from, ends[i] - from, batch_rows, batch_bytes, out[i]);
+        }
+    };
+
+    threads = std::max(1, std::min(threads, static_cast<int>(ends.size())));
+    auto pool = std::vector<std::thread>();
+    for (int t = 1; t < threads; ++t) { pool.emplace_back(worker); }
+    worker();
+    for (auto& th : pool) { th.join(); }
+}
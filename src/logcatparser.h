@@ -0,0 +1,60 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef LOGCATPARSER_H
+#define LOGCATPARSER_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "logcatstore.h"
+
+
+// Single-pass scanner for the 'threadtime' logcat format:
+//
+//   MM-DD HH:MM:SS.mmm  PID  TID P Tag: message
+//
+// Fills `row` from the raw bytes: field offsets relative to `line`, the line size
+// without the line terminator, PID/TID, the packed timestamp and the priority.
+// `row.offset` is left untouched. Returns false if the line is malformed, in
+// which case `row` is left in an unspecified state.
+bool parse_threadtime_line(const char* line, ptrdiff_t size, LogcatRow_t& row);
+
+LogcatPriority_t priority_from_char(char c);
+char priority_to_char(LogcatPriority_t p);
+
+
+using LogcatBatchList_t = std::vector<std::unique_ptr<LogcatBatch_t>>;
+
+// Ends of consecutive chunks of about `chunk_bytes` each, every chunk but the last one
+// ends right after a '\n'.
+std::vector<size_t> split_lines(const char* data, size_t size, size_t chunk_bytes);
+
+// Parses the lines of data[0, size), including an unterminated last one, and appends the
+// rows to `batches`. A new batch is started after `batch_rows` rows or `batch_bytes` bytes.
+// Malformed lines are skipped.
+void parse_lines(const char* data, size_t size, size_t batch_rows, size_t batch_bytes, LogcatBatchList_t& batches);
+
+// Chunk i is data[ends[i - 1], ends[i]), the first one starts at `begin`. The chunks are
+// parsed on up to `threads` threads and the batches of chunk i go to out[i], so the rows
+// keep the order of the input when the lists are taken in turn.
+void parse_chunks(const char* data, size_t begin, const std::vector<size_t>& ends, int threads,
+                  size_t batch_rows, size_t batch_bytes, std::vector<LogcatBatchList_t>& out);
+
+
+#endif // LOGCATPARSER_H
@@ -0,0 +1,143 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "pch.h"
+#include "logcatprocessresolver.h"
+
+#include <algorithm>
+
+#include <QRegularExpression>
+
+
+LogcatProcessResolver::LogcatProcessResolver()
+{
+    qRegisterMetaType<LogcatPsListPtr_t>();
+}
+
+
+LogcatProcessResolver::~LogcatProcessResolver()
+{}
+
+
+void LogcatProcessResolver::setCommand(const QString& cmd, const QStringList& args)
+{
+    cmd_ = cmd;
+    args_ = args;
+}
+
+
+void LogcatProcessResolver::setMinInterval(int msecs)
+{
+    min_interval_msecs_ = std::max(0, msecs);
+}
+
+
+void LogcatProcessResolver::request(const QVector<int>& pids)
+{
+    if (! proc_) {
+        proc_ = new QProcess(this);
+        connect(proc_, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), this, &LogcatProcessResolver::onFinished);
+        connect(proc_, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart) { onFinished(-1, QProcess::CrashExit); }
+        });
+
+        delay_timer_ = new QTimer(this);
+        delay_timer_->setSingleShot(true);
+        connect(delay_timer_, &QTimer::timeout, this, &LogcatProcessResolver::run);
+
+        timeout_timer_ = new QTimer(this);
+        timeout_timer_->setSingleShot(true);
+        timeout_timer_->setInterval(10000);
+        connect(timeout_timer_, &QTimer::timeout, proc_, &QProcess::kill);
+    }
+
+    pending_pids_.insert(pids.begin(), pids.end());
+
+    if (proc_->state() != QProcess::NotRunning) {
+        dirty_ = true;  // picked up when the current run finishes
+        return;
+    }
+    if (delay_timer_->isActive()) { return; }
+
+    const auto since = last_run_.isValid() ? last_run_.elapsed() : min_interval_msecs_;
+    delay_timer_->start(static_cast<int>(std::max<qint64>(0, min_interval_msecs_ - since)));
+}
+
+
+void LogcatProcessResolver::stop()
+{
+    if (delay_timer_) { delay_timer_->stop(); }
+    if (proc_) {
+        proc_->disconnect(this);
+        proc_->kill();
+        proc_->waitForFinished(1000);
+    }
+}
+
+
+void LogcatProcessResolver::run()
+{
+    dirty_ = false;
+    running_pids_.swap(pending_pids_);
+    pending_pids_.clear();
+
+    last_run_.start();
+    run_time_.start();
+    timeout_timer_->start();
+    proc_->start(cmd_, args_);
+}
+
+
+void LogcatProcessResolver::onFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    Q_UNUSED(exitCode);
+    Q_UNUSED(exitStatus);
+    timeout_timer_->stop();
+
+    static const auto re = QRegularExpression(QStringLiteral(R"(^(\S+)\s+(\d+)\s+(\d+)\s+(.+)$)"));
+
+    auto list = std::make_shared<LogcatPsList_t>();
+    auto found = std::unordered_set<int>();
+
+    proc_->setReadChannel(QProcess::StandardOutput);
+    while (! proc_->atEnd()) {
+        const auto match = re.match(QString::fromUtf8(proc_->readLine().trimmed()));
+        if (! match.hasMatch()) { continue; }
+        auto entry = LogcatPsEntry_t {
+            match.captured(2).toInt(),
+            match.captured(3).toInt(),
+            match.captured(1),
+            match.captured(4)
+        };
+        found.insert(entry.pid);
+        list->push_back(std::move(entry));
+    }
+
+    for (auto pid: running_pids_) {
+        if (found.find(pid) == found.end()) {
+            list->push_back({pid, 0, QStringLiteral("unknown"), QStringLiteral("unknown")});
+        }
+    }
+    running_pids_.clear();
+
+    emit updated(list, run_time_.elapsed());
+
+    if (dirty_ || ! pending_pids_.empty()) {
+        dirty_ = false;
+        delay_timer_->start(min_interval_msecs_);
+    }
+}
@@ -0,0 +1,90 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef LOGCATPROCESSRESOLVER_H
+#define LOGCATPROCESSRESOLVER_H
+
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QProcess>
+#include <QTimer>
+#include <QVector>
+
+
+// One line of `ps -o USER,PID,PPID,NAME` output.
+struct LogcatPsEntry_t
+{
+    int pid;
+    int ppid;
+    QString user;
+    QString name;
+};
+
+using LogcatPsList_t = std::vector<LogcatPsEntry_t>;
+using LogcatPsListPtr_t = std::shared_ptr<const LogcatPsList_t>;
+
+Q_DECLARE_METATYPE(LogcatPsListPtr_t)
+
+
+// Runs psCommand() on a worker thread and publishes the parsed process table.
+// Requests arriving while `ps` runs are coalesced into a single follow-up run,
+// and runs are at least minInterval() msecs apart.
+class LogcatProcessResolver : public QObject
+{
+    Q_OBJECT
+
+  public:
+    LogcatProcessResolver();
+    virtual ~LogcatProcessResolver();
+
+    int minInterval() const { return min_interval_msecs_; }
+
+  public slots:
+    void setCommand(const QString& cmd, const QStringList& args);
+    void setMinInterval(int msecs);
+    // Re-read the process table; `pids` that are still missing afterwards get a placeholder entry.
+    void request(const QVector<int>& pids);
+    void stop();
+
+  signals:
+    // Entries for every process seen by this `ps` run plus placeholders, the time `ps` took.
+    void updated(LogcatPsListPtr_t list, qint64 msecs);
+
+  private slots:
+    void run();
+    void onFinished(int exitCode, QProcess::ExitStatus exitStatus);
+
+  private:
+    QString cmd_;
+    QStringList args_;
+    QProcess* proc_ = nullptr;
+    QTimer* delay_timer_ = nullptr;
+    QTimer* timeout_timer_ = nullptr;
+    QElapsedTimer last_run_;
+    QElapsedTimer run_time_;
+    int min_interval_msecs_ = 1000;
+    bool dirty_ = false;
+    std::unordered_set<int> pending_pids_;
+    std::unordered_set<int> running_pids_;
+};
+
+
+#endif // LOGCATPROCESSRESOLVER_H
@@ -0,0 +1,396 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "pch.h"
+#include "logcatreader.h"
+#include "logcatparser.h"
+
+#include <algorithm>
+#include <functional>
+#include <string_view>
+#include <thread>
+
+#include <QDateTime>
+#include <QElapsedTimer>
+
+
+LogcatReader::LogcatReader(size_t queue_capacity)
+        : queue_(queue_capacity)
+        , free_(queue_capacity)
+{}
+
+
+LogcatReader::~LogcatReader()
+{
+    closeImport();
+}
+
+
+bool LogcatReader::pop(Batch_t& batch)
+{
+    return queue_.pop(batch);
+}
+
+
+void LogcatReader::recycle(Batch_t&& batch)
+{
+    batch->clear();
+    free_.push(std::move(batch));  // dropped if the free list is full
+}
+
+
+LogcatIngestStats_t LogcatReader::stats() const
+{
+    auto s = LogcatIngestStats_t();
+    s.queue_depth = queue_.size();
+    s.queue_capacity = queue_.capacity();
+    s.batches = batches_.load(std::memory_order_relaxed);
+    s.rows = rows_.load(std::memory_order_relaxed);
+    s.bytes = bytes_.load(std::memory_order_relaxed);
+    s.backpressured = backpressured_.load(std::memory_order_relaxed);
+    s.dropped_batches = dropped_batches_.load(std::memory_order_relaxed);
+    s.dropped_rows = dropped_rows_.load(std::memory_order_relaxed);
+    s.malformed = malformed_.load(std::memory_order_relaxed);
+    s.reconnects = reconnects_.load(std::memory_order_relaxed);
+    s.duplicates = duplicates_.load(std::memory_order_relaxed);
+    return s;
+}
+
+
+void LogcatReader::start(const QString& cmd, const QStringList& args, std::shared_ptr<LogcatDecoder> decoder)
+{
+    if (! proc_) {
+        proc_ = new QProcess(this);
+        connect(proc_, &QProcess::readyReadStandardOutput, this, &LogcatReader::onReadyRead);
+        connect(proc_, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), this, &LogcatReader::onFinished);
+        connect(proc_, &QProcess::errorOccurred, this, &LogcatReader::onProcessError);
+        createRetryTimer();
+    }
+
+    decoder_ = decoder ? std::move(decoder) : std::shared_ptr<LogcatDecoder>(make_decoder(LogcatFormat_t::Text));
+    pending_.clear();
+    proc_->start(cmd, args);
+}
+
+
+void LogcatReader::resume(const QString& cmd, const QStringList& args, const QString& reason)
+{
+    if (! proc_ || proc_->state() != QProcess::NotRunning) { return; }
+
+    auto resume_args = args;
+    if (has_last_) {
+        // rows of the binary format have the host's local time, the device would read it in
+        // its own timezone, so the decoder gives the epoch time of the record instead; the
+        // device shell splits the command line, the text time has a space in it
+        const auto since = decoder_->resumeTime();
+        resume_args << QStringLiteral("-T")
+                    << (since.empty() ? QStringLiteral("'%1'").arg(QString::fromStdString(format_timestamp(last_timestamp_)))
+                                      : QString::fromStdString(since));
+        overlap_ = tail_;
+        resuming_ = true;
+    }
+    // if the previous attempt delivered nothing new, the gap goes on since its start
+    gap_reason_ = reason;
+    awaiting_output_ = true;
+    reconnects_.fetch_add(1, std::memory_order_relaxed);
+
+    pending_.clear();
+    proc_->start(cmd, resume_args);
+}
+
+
+void LogcatReader::onProcessError(QProcess::ProcessError error)
+{
+    // a process that never started does not emit finished()
+    if (error == QProcess::FailedToStart) { onFinished(-1, QProcess::CrashExit); }
+}
+
+
+void LogcatReader::onFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    // failed attempts to resume extend the gap, they do not start a new one
+    if (gap_reason_.isEmpty()) { gap_started_ = QDateTime::currentMSecsSinceEpoch(); }
+    emit finished(exitCode, exitStatus);
+}
+
+
+void LogcatReader::stop()
+{
+    if (proc_) {
+        proc_->disconnect(this);
+        proc_->kill();
+        proc_->waitForFinished(1000);
+        delete proc_;   // a late resume() finds nothing to restart
+        proc_ = nullptr;
+    }
+    tee_.reset();
+    closeImport();
+}
+
+
+void LogcatReader::setTee(std::shared_ptr<LogcatTeeWriter> tee)
+{
+    tee_ = std::move(tee);
+}
+
+
+void LogcatReader::setMetrics(std::shared_ptr<LogcatMetrics> metrics)
+{
+    metrics_ = std::move(metrics);
+}
+
+
+void LogcatReader::importFile(const QString& path)
+{
+    closeImport();
+    createRetryTimer();
+
+    auto file = std::make_unique<QFile>(path);
+    if (! file->open(QIODevice::ReadOnly)) {
+        emit importFinished(file->errorString());
+        return;
+    }
+    const auto size = static_cast<size_t>(file->size());
+    const char* data = nullptr;
+    if (size > 0) {
+        data = reinterpret_cast<const char*>(file->map(0, file->size()));
+        if (! data) {
+            emit importFinished(file->errorString());
+            return;
+        }
+    }
+
+    import_file_ = file.release();
+    import_data_ = data;
+    import_ends_ = split_lines(data, size, Import_Chunk_Bytes);
+    import_next_ = 0;
+    import_threads_ = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    emit importProgress(0, static_cast<qint64>(size));
+    QTimer::singleShot(0, this, &LogcatReader::importStep);
+}
+
+
+void LogcatReader::importStep()
+{
+    if (! import_file_) { return; }
+
+    // the GUI thread has not caught up with the previous wave yet
+    flushHeld();
+    if (! held_.empty()) {
+        QTimer::singleShot(5, this, &LogcatReader::importStep);
+        return;
+    }
+
+    if (import_next_ == import_ends_.size()) {
+        closeImport();
+        emit importFinished(QString());
+        return;
+    }
+
+    const auto first = import_next_;
+    const auto last = std::min(import_ends_.size(), first + static_cast<size_t>(import_threads_));
+    const auto begin = first == 0 ? size_t(0) : import_ends_[first - 1];
+    const auto ends = std::vector<size_t>(import_ends_.begin() + first, import_ends_.begin() + last);
+
+    auto parsed = std::vector<LogcatBatchList_t>();
+    parse_chunks(import_data_, begin, ends, import_threads_, Batch_Rows, Batch_Bytes, parsed);
+    for (auto& chunk : parsed) {
+        for (auto& batch : chunk) { held_.push_back(std::move(batch)); }
+    }
+    import_next_ = last;
+    bytes_.fetch_add(ends.back() - begin, std::memory_order_relaxed);
+
+    flushHeld();
+    emit importProgress(static_cast<qint64>(ends.back()), static_cast<qint64>(import_ends_.back()));
+    QTimer::singleShot(0, this, &LogcatReader::importStep);
+}
+
+
+void LogcatReader::createRetryTimer()
+{
+    if (retry_timer_) { return; }
+
+    retry_timer_ = new QTimer(this);
+    retry_timer_->setSingleShot(true);
+    retry_timer_->setInterval(5);
+    connect(retry_timer_, &QTimer::timeout, this, &LogcatReader::flushHeld);
+}
+
+
+void LogcatReader::closeImport()
+{
+    if (! import_file_) { return; }
+
+    held_.clear();
+    delete import_file_;
+    import_file_ = nullptr;
+    import_data_ = nullptr;
+    import_ends_.clear();
+    import_next_ = 0;
+}
+
+
+void LogcatReader::onReadyRead()
+{
+    proc_->setReadChannel(QProcess::StandardOutput);
+    const auto data = proc_->readAll();
+    if (awaiting_output_ && ! data.isEmpty()) {
+        awaiting_output_ = false;
+        emit resumed();
+    }
+    bytes_.fetch_add(data.size(), std::memory_order_relaxed);
+    if (tee_) { tee_->write(data); }
+    pending_.append(data);
+    if (metrics_) {
+        auto timer = QElapsedTimer();
+        timer.start();
+        const auto rows = decoded_rows_;
+        parsePending();
+        metrics_->read_bytes.record(static_cast<uint64_t>(data.size()));
+        if (decoded_rows_ > rows) {
+            metrics_->parse_ns_per_line.record(static_cast<uint64_t>(timer.nsecsElapsed()) / (decoded_rows_ - rows));
+        }
+    } else {
+        parsePending();
+    }
+
+    // publish what we have, so that a quiet stream still shows up promptly
+    sealCurrent();
+    flushHeld();
+}
+
+
+void LogcatReader::parsePending()
+{
+    const auto used = decoder_->decode(pending_.constData(), static_cast<size_t>(pending_.size()), *this);
+    pending_.remove(0, static_cast<int>(used));
+    malformed_.store(decoder_->malformed(), std::memory_order_relaxed);
+}
+
+
+void LogcatReader::addRow(const LogcatRow_t& row, const char* line)
+{
+    decoded_rows_ += 1;
+    if (resuming_ && isDuplicate(row, line)) {
+        duplicates_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (! gap_reason_.isEmpty()) { addGapMarker(row.timestamp); }
+
+    const auto hash = std::hash<std::string_view>()(std::string_view(line, row.size));
+    if (! has_last_ || row.timestamp > last_timestamp_) {
+        last_timestamp_ = row.timestamp;
+        has_last_ = true;
+        tail_.clear();
+    }
+    if (row.timestamp == last_timestamp_) { tail_.push_back(hash); }
+
+    appendRow(row, line);
+}
+
+
+bool LogcatReader::isDuplicate(const LogcatRow_t& row, const char* line)
+{
+    // 'logcat -T' repeats the rows of the resume time, older ones are only expected if the
+    // device clock stepped back
+    if (row.timestamp > last_timestamp_) {
+        resuming_ = false;
+        overlap_.clear();
+        return false;
+    }
+    if (row.timestamp < last_timestamp_) { return false; }
+
+    const auto hash = std::hash<std::string_view>()(std::string_view(line, row.size));
+    const auto it = std::find(overlap_.begin(), overlap_.end(), hash);
+    if (it == overlap_.end()) { return false; }
+    overlap_.erase(it);
+    return true;
+}
+
+
+void LogcatReader::addGapMarker(LogcatTimestamp_t timestamp)
+{
+    const auto gap_msecs = std::max<qint64>(0, QDateTime::currentMSecsSinceEpoch() - gap_started_);
+    const auto text = QStringLiteral("%1     0     0 W qLogcat: --------- capture resumed after %2 s: %3")
+            .arg(QString::fromStdString(format_timestamp(timestamp)))
+            .arg(static_cast<double>(gap_msecs) / 1000, 0, 'f', 1)
+            .arg(gap_reason_)
+            .toUtf8();
+    gap_reason_.clear();
+
+    auto row = LogcatRow_t();
+    if (! parse_threadtime_line(text.constData(), text.size(), row)) { return; }
+    row.timestamp = timestamp;
+    appendRow(row, text.constData());
+}
+
+
+void LogcatReader::appendRow(const LogcatRow_t& row, const char* line)
+{
+    if (! current_) { current_ = takeFreeBatch(); }
+
+    auto r = row;
+    r.offset = static_cast<uint32_t>(current_->bytes.size());
+    r.device = device_;
+    current_->bytes.insert(current_->bytes.end(), line, line + row.size);
+    current_->rows.push_back(r);
+
+    if (current_->rows.size() >= Batch_Rows || current_->bytes.size() >= Batch_Bytes) {
+        sealCurrent();
+    }
+}
+
+
+void LogcatReader::sealCurrent()
+{
+    if (! current_ || current_->rows.empty()) { return; }
+
+    held_.push_back(std::move(current_));
+    if (held_.size() > Max_Held_Batches) {
+        dropped_batches_.fetch_add(1, std::memory_order_relaxed);
+        dropped_rows_.fetch_add(held_.front()->rows.size(), std::memory_order_relaxed);
+        held_.pop_front();
+    }
+}
+
+
+void LogcatReader::flushHeld()
+{
+    while (! held_.empty()) {
+        const auto rows = held_.front()->rows.size();
+        if (! queue_.push(std::move(held_.front()))) {
+            backpressured_.fetch_add(1, std::memory_order_relaxed);
+            if (! retry_timer_->isActive()) { retry_timer_->start(); }
+            return;
+        }
+        held_.pop_front();
+        batches_.fetch_add(1, std::memory_order_relaxed);
+        rows_.fetch_add(rows, std::memory_order_relaxed);
+    }
+}
+
+
+LogcatReader::Batch_t LogcatReader::takeFreeBatch()
+{
+    auto batch = Batch_t();
+    if (free_.pop(batch)) { return batch; }
+
+    batch = std::make_unique<LogcatBatch_t>();
+    batch->rows.reserve(Batch_Rows);
+    batch->bytes.reserve(Batch_Bytes + 8192);
+    return batch;
+}
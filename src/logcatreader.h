@@ -0,0 +1,179 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef LOGCATREADER_H
+#define LOGCATREADER_H
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <QFile>
+#include <QObject>
+#include <QProcess>
+#include <QTimer>
+
+#include "logcatdecoder.h"
+#include "logcatmetrics.h"
+#include "logcatspscqueue.h"
+#include "logcatstore.h"
+#include "logcatteewriter.h"
+
+
+struct LogcatIngestStats_t
+{
+    size_t queue_depth = 0;
+    size_t queue_capacity = 0;
+    uint64_t batches = 0;
+    uint64_t rows = 0;
+    uint64_t bytes = 0;
+    uint64_t backpressured = 0;     // publish attempts that found the queue full
+    uint64_t dropped_batches = 0;
+    uint64_t dropped_rows = 0;
+    uint64_t malformed = 0;         // records the decoder skipped
+    uint64_t reconnects = 0;
+    uint64_t duplicates = 0;        // rows a resumed logcat repeated
+};
+
+
+// Consumer side of a stream of parsed batches, consumed batches are handed back to be reused.
+class LogcatBatchQueue
+{
+  public:
+    using Batch_t = std::unique_ptr<LogcatBatch_t>;
+
+    virtual ~LogcatBatchQueue() = default;
+    virtual bool pop(Batch_t& batch) = 0;
+    virtual void recycle(Batch_t&& batch) = 0;
+};
+
+
+// Owns the logcat process and decodes its output into batches on a worker thread.
+// Full batches are handed to the GUI thread through a single-producer/single-consumer
+// queue, consumed batches are returned through a second one to be reused.
+//
+// A text dump can be imported instead: the file is mapped, split into chunks on line
+// boundaries and the chunks are parsed in parallel, a wave of them per event loop turn.
+// The batches are published in file order and, unlike a live capture, never dropped.
+//
+// A capture that ended can be resumed: logcat is restarted with '-T <last timestamp>' and
+// the rows it repeats are skipped. The first new row is preceded by a marker row that
+// records the gap.
+class LogcatReader : public QObject, public LogcatBatchQueue, private LogcatRowSink
+{
+    Q_OBJECT
+
+  public:
+    static const size_t Batch_Rows = 1024;
+    static const size_t Batch_Bytes = 256 * 1024;
+    static const size_t Max_Held_Batches = 256;
+    static const size_t Import_Chunk_Bytes = 4 * 1024 * 1024;
+
+    explicit LogcatReader(size_t queue_capacity = 64);
+    virtual ~LogcatReader();
+
+    // Rows are tagged with the device index, set it before start().
+    void setDevice(int device) { device_ = static_cast<uint8_t>(device); }
+
+    // Consumer (GUI or merger thread) side.
+    bool pop(Batch_t& batch) override;
+    void recycle(Batch_t&& batch) override;
+    LogcatIngestStats_t stats() const;
+
+  public slots:
+    // The output of the process is decoded with `decoder`, 'threadtime' text if it is null.
+    void start(const QString& cmd, const QStringList& args, std::shared_ptr<LogcatDecoder> decoder = nullptr);
+    // Restarts the process with the same decoder after finished(), `args` get '-T <time>'
+    // appended. `reason` goes to the gap marker row.
+    void resume(const QString& cmd, const QStringList& args, const QString& reason);
+    void stop();
+    void importFile(const QString& path);
+    // The raw output of the process is passed to `tee` before it is parsed, null turns it off.
+    void setTee(std::shared_ptr<LogcatTeeWriter> tee);
+    // Read sizes and parse times are recorded into `metrics`, null turns it off.
+    void setMetrics(std::shared_ptr<LogcatMetrics> metrics);
+
+  signals:
+    void finished(int exitCode, QProcess::ExitStatus exitStatus);
+    // The resumed process produced output.
+    void resumed();
+    void importProgress(qint64 done, qint64 total);
+    void importFinished(const QString& error);
+
+  private slots:
+    void onReadyRead();
+    void onProcessError(QProcess::ProcessError error);
+    void onFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void flushHeld();
+    void importStep();
+
+  private:
+    void createRetryTimer();
+    void closeImport();
+    void parsePending();
+    void addRow(const LogcatRow_t& row, const char* line) override;
+    bool isDuplicate(const LogcatRow_t& row, const char* line);
+    void addGapMarker(LogcatTimestamp_t timestamp);
+    void appendRow(const LogcatRow_t& row, const char* line);
+    void sealCurrent();
+    Batch_t takeFreeBatch();
+
+  private:
+    QProcess* proc_ = nullptr;
+    QTimer* retry_timer_ = nullptr;
+    QByteArray pending_;
+    std::shared_ptr<LogcatDecoder> decoder_;
+    uint8_t device_ = 0;
+    Batch_t current_;
+    std::deque<Batch_t> held_;      // sealed batches waiting for space in queue_
+    LogcatSpscQueue<Batch_t> queue_;
+    LogcatSpscQueue<Batch_t> free_;
+    std::shared_ptr<LogcatTeeWriter> tee_;
+    std::shared_ptr<LogcatMetrics> metrics_;
+    uint64_t decoded_rows_ = 0;     // rows the decoder produced, repeated ones included
+
+    // the newest timestamp seen and hashes of the rows that have it, to skip what a resumed
+    // logcat repeats
+    LogcatTimestamp_t last_timestamp_ = 0;
+    bool has_last_ = false;
+    std::vector<size_t> tail_;
+    std::vector<size_t> overlap_;   // tail_ at the time of resume, not matched yet
+    bool resuming_ = false;
+    bool awaiting_output_ = false;
+    QString gap_reason_;            // a marker row is due before the next new row
+    qint64 gap_started_ = 0;        // msecs since epoch
+
+    QFile* import_file_ = nullptr;
+    const char* import_data_ = nullptr;
+    std::vector<size_t> import_ends_;
+    size_t import_next_ = 0;        // first chunk of import_ends_ not parsed yet
+    int import_threads_ = 1;
+
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> rows_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> backpressured_{0};
+    std::atomic<uint64_t> dropped_batches_{0};
+    std::atomic<uint64_t> dropped_rows_{0};
+    std::atomic<uint64_t> malformed_{0};
+    std::atomic<uint64_t> reconnects_{0};
+    std::atomic<uint64_t> duplicates_{0};
+};
+
+
+#endif // LOGCATREADER_H
@@ -0,0 +1,217 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+
+#include "logcatrowbitmap.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+
+static const size_t Container_Words = (size_t(1) << LogcatRowBitmap::Container_Bits) / 64;
+
+
+static int popcount(uint64_t word)
+{
+    int n = 0;
+    for (; word; word &= word - 1) { ++n; }
+    return n;
+}
+
+
+static int lowest_bit(uint64_t word)
+{
+    int n = 0;
+    for (; ! (word & 1); word >>= 1) { ++n; }
+    return n;
+}
+
+
+bool LogcatRowBitmap::Container_t::contains(uint16_t low) const
+{
+    if (! bits.empty()) { return (bits[low >> 6] >> (low & 63)) & 1; }
+    return std::binary_search(array.begin(), array.end(), low);
+}
+
+
+void LogcatRowBitmap::Container_t::toBits()
+{
+    bits.assign(Container_Words, 0);
+    for (auto low : array) { bits[low >> 6] |= uint64_t(1) << (low & 63); }
+    array = std::vector<uint16_t>();
+}
+
+
+void LogcatRowBitmap::Container_t::toArray()
+{
+    array.clear();
+    array.reserve(count);
+    for (size_t w = 0; w < bits.size(); ++w) {
+        for (auto word = bits[w]; word; word &= word - 1) {
+            array.push_back(static_cast<uint16_t>(w * 64 + lowest_bit(word)));
+        }
+    }
+    bits = std::vector<uint64_t>();
+}
+
+
+void LogcatRowBitmap::add(uint64_t seq)
+{
+    const auto key = seq >> Container_Bits;
+    const auto low = static_cast<uint16_t>(seq);
+    if (containers_.empty() || containers_.back().key != key) {
+        containers_.emplace_back();
+        containers_.back().key = key;
+    }
+
+    auto& c = containers_.back();
+    if (c.bits.empty()) {
+        if (! c.array.empty() && c.array.back() >= low) { return; }
+        c.array.push_back(low);
+        c.count += 1;
+        if (c.count > Max_Array) { c.toBits(); }
+    } else if (! c.contains(low)) {
+        c.bits[low >> 6] |= uint64_t(1) << (low & 63);
+        c.count += 1;
+    }
+}
+
+
+void LogcatRowBitmap::evictBefore(uint64_t seq)
+{
+    while (! containers_.empty() && (containers_.front().key + 1) << Container_Bits <= seq) {
+        containers_.pop_front();
+    }
+}
+
+
+size_t LogcatRowBitmap::cardinality() const
+{
+    size_t n = 0;
+    for (const auto& c : containers_) { n += c.count; }
+    return n;
+}
+
+
+size_t LogcatRowBitmap::memoryUsage() const
+{
+    size_t bytes = 0;
+    for (const auto& c : containers_) {
+        bytes += sizeof(Container_t) + c.array.capacity() * sizeof(uint16_t) + c.bits.capacity() * sizeof(uint64_t);
+    }
+    return bytes;
+}
+
+
+void LogcatRowBitmap::collect(uint64_t first, uint64_t end, std::vector<uint64_t>& seqs) const
+{
+    for (const auto& c : containers_) {
+        const auto base = c.key << Container_Bits;
+        if (base >= end) { break; }
+        if (base + (uint64_t(1) << Container_Bits) <= first) { continue; }
+
+        auto push = [&seqs, first, end](uint64_t seq) {
+            if (seq >= first && seq < end) { seqs.push_back(seq); }
+        };
+        if (c.bits.empty()) {
+            for (auto low : c.array) { push(base + low); }
+        } else {
+            for (size_t w = 0; w < c.bits.size(); ++w) {
+                for (auto word = c.bits[w]; word; word &= word - 1) { push(base + w * 64 + lowest_bit(word)); }
+            }
+        }
+    }
+}
+
+
+LogcatRowBitmap LogcatRowBitmap::unite(const std::vector<const LogcatRowBitmap*>& bitmaps)
+{
+    auto parts = std::vector<const Container_t*>();
+    for (const auto* bitmap : bitmaps) {
+        for (const auto& c : bitmap->containers_) { parts.push_back(&c); }
+    }
+    std::stable_sort(parts.begin(), parts.end(), [](const Container_t* a, const Container_t* b) { return a->key < b->key; });
+
+    auto result = LogcatRowBitmap();
+    for (size_t i = 0; i < parts.size();) {
+        auto j = i;
+        size_t total = 0;
+        for (; j < parts.size() && parts[j]->key == parts[i]->key; ++j) { total += parts[j]->count; }
+
+        auto c = Container_t();
+        c.key = parts[i]->key;
+        if (j - i == 1) {
+            c = *parts[i];
+        } else if (total <= Max_Array) {
+            // arrays only, a bitset always holds more rows
+            for (auto k = i; k < j; ++k) { c.array.insert(c.array.end(), parts[k]->array.begin(), parts[k]->array.end()); }
+            std::sort(c.array.begin(), c.array.end());
+            c.array.erase(std::unique(c.array.begin(), c.array.end()), c.array.end());
+            c.count = static_cast<uint32_t>(c.array.size());
+        } else {
+            c.bits.assign(Container_Words, 0);
+            for (auto k = i; k < j; ++k) {
+                const auto& p = *parts[k];
+                for (auto low : p.array) { c.bits[low >> 6] |= uint64_t(1) << (low & 63); }
+                for (size_t w = 0; w < p.bits.size(); ++w) { c.bits[w] |= p.bits[w]; }
+            }
+            for (auto word : c.bits) { c.count += popcount(word); }
+            if (c.count <= Max_Array) { c.toArray(); }
+        }
+        result.containers_.push_back(std::move(c));
+        i = j;
+    }
+    return result;
+}
+
+
+LogcatRowBitmap LogcatRowBitmap::intersect(const LogcatRowBitmap& a, const LogcatRowBitmap& b)
+{
+    auto result = LogcatRowBitmap();
+    auto ia = a.containers_.begin();
+    auto ib = b.containers_.begin();
+    while (ia != a.containers_.end() && ib != b.containers_.end()) {
+        if (ia->key < ib->key) { ++ia; continue; }
+        if (ib->key < ia->key) { ++ib; continue; }
+
+        auto c = Container_t();
+        c.key = ia->key;
+        if (ia->bits.empty() && ib->bits.empty()) {
+            std::set_intersection(ia->array.begin(), ia->array.end(), ib->array.begin(), ib->array.end(),
+                                  std::back_inserter(c.array));
+        } else if (ia->bits.empty() || ib->bits.empty()) {
+            const auto& sparse = ia->bits.empty() ? *ia : *ib;
+            const auto& dense = ia->bits.empty() ? *ib : *ia;
+            for (auto low : sparse.array) {
+                if (dense.contains(low)) { c.array.push_back(low); }
+            }
+        } else {
+            c.bits.resize(Container_Words);
+            for (size_t w = 0; w < Container_Words; ++w) {
+                c.bits[w] = ia->bits[w] & ib->bits[w];
+                c.count += popcount(c.bits[w]);
+            }
+            if (c.count <= Max_Array) { c.toArray(); }
+        }
+        if (c.bits.empty()) { c.count = static_cast<uint32_t>(c.array.size()); }
+        if (c.count > 0) { result.containers_.push_back(std::move(c)); }
+        ++ia;
+        ++ib;
+    }
+    return result;
+}
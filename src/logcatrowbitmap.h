@@ -0,0 +1,75 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+
+#ifndef LOGCATROWBITMAP_H
+#define LOGCATROWBITMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+
+// Compressed set of row sequence numbers, split the roaring way into containers of 2^16
+// rows. A container holds a sorted array of the low 16 bits while it has at most
+// Max_Array rows, a bitset of 1024 words once it has more, so a sparse set costs two bytes
+// per row and a dense one a bit per row.
+//
+// Rows are added in ascending order as they are appended to the store, the containers
+// are dropped from the front as rows are evicted.
+class LogcatRowBitmap
+{
+  public:
+    static const int Container_Bits = 16;
+    static const size_t Max_Array = 4096;
+
+    void add(uint64_t seq);
+    // Drops the containers that only hold rows before `seq`.
+    void evictBefore(uint64_t seq);
+    void clear() { containers_.clear(); }
+
+    bool empty() const { return containers_.empty(); }
+    // Rows of the first container before the last evictBefore() are counted too.
+    size_t cardinality() const;
+    size_t memoryUsage() const;
+
+    // Appends the rows within [first, end) to `seqs` in ascending order.
+    void collect(uint64_t first, uint64_t end, std::vector<uint64_t>& seqs) const;
+
+    static LogcatRowBitmap unite(const std::vector<const LogcatRowBitmap*>& bitmaps);
+    static LogcatRowBitmap intersect(const LogcatRowBitmap& a, const LogcatRowBitmap& b);
+
+  private:
+    struct Container_t
+    {
+        uint64_t key = 0;               // seq >> Container_Bits
+        uint32_t count = 0;
+        std::vector<uint16_t> array;    // while count <= Max_Array
+        std::vector<uint64_t> bits;     // otherwise
+
+        bool contains(uint16_t low) const;
+        void toBits();
+        void toArray();
+    };
+
+  private:
+    std::deque<Container_t> containers_;
+};
+
+
+#endif // LOGCATROWBITMAP_H
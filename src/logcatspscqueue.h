@@ -0,0 +1,78 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef LOGCATSPSCQUEUE_H
+#define LOGCATSPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+template<typename T>
+class LogcatSpscQueue
+{
+  public:
+    explicit LogcatSpscQueue(size_t capacity)
+    {
+        size_t n = 2;
+        while (n < capacity) { n *= 2; }
+        items_.resize(n);
+        mask_ = n - 1;
+    }
+
+    LogcatSpscQueue(const LogcatSpscQueue&) = delete;
+    LogcatSpscQueue& operator=(const LogcatSpscQueue&) = delete;
+
+    // Producer side. Returns false if the queue is full, `item` is left untouched then.
+    bool push(T&& item)
+    {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) > mask_) { return false; }
+        items_[tail & mask_] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false if the queue is empty.
+    bool pop(T& item)
+    {
+        const auto head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) { return false; }
+        item = std::move(items_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called concurrently with push/pop.
+    size_t size() const
+    {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+  private:
+    std::vector<T> items_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+};
+
+
+#endif // LOGCATSPSCQUEUE_H
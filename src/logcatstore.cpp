@@ -0,0 +1,287 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "logcatstore.h"
+
+#include <algorithm>
+#include <cstdio>
+
+
+LogcatTimestamp_t pack_timestamp(int month, int day, int hour, int minute, int second, int nsec)
+{
+    LogcatTimestamp_t t = month;
+    t = t * 32 + day;
+    t = t * 24 + hour;
+    t = t * 60 + minute;
+    t = t * 60 + second;
+    return t * 1000000000 + nsec;
+}
+
+
+int64_t timestamp_to_msecs(LogcatTimestamp_t t)
+{
+    static const int days_before_month[] = {0, 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+
+    const int64_t nsec = t % 1000000000;
+    t /= 1000000000;
+    const int64_t second = t % 60;
+    t /= 60;
+    const int64_t minute = t % 60;
+    t /= 60;
+    const int64_t hour = t % 24;
+    t /= 24;
+    const int64_t day = t % 32;
+    const int64_t month = t / 32;
+
+    const int64_t days = (month >= 1 && month <= 12 ? days_before_month[month] : 0) + day;
+    return (((days * 24 + hour) * 60 + minute) * 60 + second) * 1000 + nsec / 1000000;
+}
+
+
+std::string format_timestamp(LogcatTimestamp_t t)
+{
+    const auto nsec = static_cast<int>(t % 1000000000);
+    t /= 1000000000;
+    const auto second = static_cast<int>(t % 60);
+    t /= 60;
+    const auto minute = static_cast<int>(t % 60);
+    t /= 60;
+    const auto hour = static_cast<int>(t % 24);
+    t /= 24;
+    const auto day = static_cast<int>(t % 32);
+    const auto month = static_cast<int>(t / 32);
+
+    char buf[32];
+    if (nsec % 1000000 == 0) {
+        std::snprintf(buf, sizeof(buf), "%02d-%02d %02d:%02d:%02d.%03d", month, day, hour, minute, second, nsec / 1000000);
+    } else {
+        std::snprintf(buf, sizeof(buf), "%02d-%02d %02d:%02d:%02d.%09d", month, day, hour, minute, second, nsec);
+    }
+    return buf;
+}
+
+
+std::string_view LogcatStore::date(size_t i) const
+{
+    const auto& r = row(i);
+    return {line(i), r.date_size};
+}
+
+
+std::string_view LogcatStore::time(size_t i) const
+{
+    const auto& r = row(i);
+    return {line(i) + r.time_offset, r.time_size};
+}
+
+
+std::string_view LogcatStore::priority(size_t i) const
+{
+    const auto& r = row(i);
+    return {line(i) + r.priority_offset, r.priority_size};
+}
+
+
+std::string_view LogcatStore::tag(size_t i) const
+{
+    const auto& r = row(i);
+    return {line(i) + r.tag_offset, r.tag_size};
+}
+
+
+std::string_view LogcatStore::message(size_t i) const
+{
+    const auto& r = row(i);
+    return {line(i) + r.message_offset, r.size - r.message_offset};
+}
+
+
+void LogcatStore::append(const char* line, const LogcatRow_t& row)
+{
+    if (blocks_.empty() || blocks_.back()->rows.size() == Block_Rows) {
+        if (! blocks_.empty()) {
+            blocks_.back()->bytes.shrink_to_fit();
+        }
+        auto block = std::make_shared<LogcatBlock_t>();
+        block->rows.reserve(Block_Rows);
+        block->bytes.reserve(Block_Rows * 128);
+        blocks_.push_back(std::move(block));
+    }
+
+    auto& block = *blocks_.back();
+    const auto offset = block.bytes.size();
+    block.bytes.insert(block.bytes.end(), line, line + row.size);
+    block.rows.push_back(row);
+    block.rows.back().offset = static_cast<uint32_t>(offset);
+    size_ += 1;
+    live_bytes_ += sizeof(LogcatRow_t) + row.size;
+}
+
+
+void LogcatStore::append(const LogcatBatch_t& batch)
+{
+    for (const auto& row : batch.rows) {
+        append(batch.bytes.data() + row.offset, row);
+    }
+}
+
+
+void LogcatStore::evictFront(size_t count)
+{
+    count = std::min(count, size_);
+    for (size_t i = 0; i < count; ++i) {
+        live_bytes_ -= sizeof(LogcatRow_t) + row(i).size;
+    }
+    head_ += count;
+    size_ -= count;
+    first_seq_ += count;
+
+    while (! blocks_.empty() && head_ >= blockRows(0)
+           && (head_ >= Block_Rows || size_ == 0)) {
+        head_ -= blockRows(0);
+        blocks_.pop_front();
+        source_first_ += 1;
+    }
+}
+
+
+void LogcatStore::clear()
+{
+    first_seq_ += size_;
+    blocks_.clear();
+    head_ = 0;
+    size_ = 0;
+    live_bytes_ = 0;
+    source_.reset();
+    source_first_ = 0;
+    loaded_.clear();
+}
+
+
+void LogcatStore::assign(std::shared_ptr<const LogcatBlockSource> source)
+{
+    clear();
+    source_ = std::move(source);
+
+    const auto count = source_->blockCount();
+    for (size_t k = 0; k < count; ++k) {
+        blocks_.push_back(std::shared_ptr<LogcatBlock_t>());
+        size_ += source_->blockRows(k);
+        live_bytes_ += source_->blockRows(k) * sizeof(LogcatRow_t) + source_->blockBytes(k);
+    }
+    // the last block stays loaded, rows may still be appended to it
+    if (count > 0) { blocks_.back() = source_->load(count - 1); }
+}
+
+
+const LogcatBlock_t& LogcatStore::loadBlock(size_t k) const
+{
+    auto& block = blocks_[k];
+    block = source_->load(source_first_ + k);
+    loaded_.push_back(source_first_ + k);
+    while (loaded_.size() > Max_Loaded_Blocks) {
+        const auto oldest = loaded_.front();
+        loaded_.pop_front();
+        if (oldest >= source_first_ && oldest - source_first_ < blocks_.size()) {
+            blocks_[oldest - source_first_].reset();
+        }
+    }
+    return *block;
+}
+
+
+size_t LogcatStore::blockRows(size_t k) const
+{
+    return blocks_[k] ? blocks_[k]->rows.size() : source_->blockRows(source_first_ + k);
+}
+
+
+LogcatStoreSnapshot_t LogcatStore::sealedSnapshot() const
+{
+    auto snapshot = LogcatStoreSnapshot_t();
+    snapshot.head = head_;
+    snapshot.first_seq = first_seq_;
+    snapshot.source = source_;
+    snapshot.source_first = source_first_;
+    if (blocks_.size() < 2) { return snapshot; }
+
+    snapshot.blocks.reserve(blocks_.size() - 1);
+    for (size_t i = 0; i + 1 < blocks_.size(); ++i) {
+        snapshot.blocks.push_back(blocks_[i]);
+    }
+    snapshot.size = std::min(size_, snapshot.blocks.size() * Block_Rows - head_);
+    return snapshot;
+}
+
+
+size_t LogcatStore::overRetention(const LogcatRetention_t& retention) const
+{
+    // Once a limit is exceeded, rows are evicted down to 15/16 of it,
+    // so that evictions happen in batches rather than on every append.
+    auto target = [](auto limit) { return limit - limit / 16; };
+    size_t count = 0;
+
+    if (retention.max_rows > 0 && size_ > retention.max_rows) {
+        count = size_ - target(retention.max_rows);
+    }
+
+    if (retention.max_bytes > 0 && live_bytes_ > retention.max_bytes) {
+        const auto max_bytes = target(retention.max_bytes);
+        auto bytes = live_bytes_;
+        size_t n = 0;
+        while (n < size_ && bytes > max_bytes) {
+            bytes -= sizeof(LogcatRow_t) + row(n).size;
+            n += 1;
+        }
+        count = std::max(count, n);
+    }
+
+    if (retention.max_age_msecs > 0 && size_ > 0) {
+        // timestamps have no year, a row that looks more than half a year newer is from the
+        // year before
+        const int64_t year_msecs = 365LL * 24 * 60 * 60 * 1000;
+        const auto newest = timestamp_to_msecs(row(size_ - 1).timestamp);
+        auto age = [newest, year_msecs](const LogcatRow_t& r) {
+            const auto msecs = newest - timestamp_to_msecs(r.timestamp);
+            return msecs < -year_msecs / 2 ? msecs + year_msecs : msecs;
+        };
+        if (age(row(0)) > retention.max_age_msecs) {
+            const auto max_age = target(retention.max_age_msecs);
+            size_t n = 0;
+            while (n < size_ && age(row(n)) > max_age) {
+                n += 1;
+            }
+            count = std::max(count, n);
+        }
+    }
+
+    return std::min(count, size_);
+}
+
+
+size_t LogcatStore::memoryUsage() const
+{
+    size_t total = blocks_.capacity() * sizeof(std::shared_ptr<LogcatBlock_t>);
+    for (size_t i = 0; i < blocks_.size(); ++i) {
+        const auto& block = blocks_[i];
+        if (! block) { continue; }
+        total += sizeof(LogcatBlock_t);
+        total += block->rows.capacity() * sizeof(LogcatRow_t);
+        total += block->bytes.capacity();
+    }
+    return total;
+}
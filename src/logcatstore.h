@@ -0,0 +1,288 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef LOGCATSTORE_H
+#define LOGCATSTORE_H
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+enum class LogcatPriority_t : uint8_t
+{
+    Unknown = 0,
+    Verbose,
+    Debug,
+    Info,
+    Warning,
+    Error,
+    Fatal,
+    Silent
+};
+
+
+// Packed local time of a record: month, day, hour, minute, second and nanoseconds,
+// ordered the same way as the textual 'MM-DD HH:MM:SS.nnnnnnnnn' form.
+using LogcatTimestamp_t = int64_t;
+
+LogcatTimestamp_t pack_timestamp(int month, int day, int hour, int minute, int second, int nsec);
+
+// Milliseconds since the start of the (unknown, non-leap) year, for computing intervals.
+int64_t timestamp_to_msecs(LogcatTimestamp_t t);
+
+const int64_t Nanos_Per_Day = 24LL * 60 * 60 * 1000000000;
+
+// The time of day of `t` on the date of `date`.
+inline LogcatTimestamp_t with_date(LogcatTimestamp_t t, LogcatTimestamp_t date)
+{
+    return date / Nanos_Per_Day * Nanos_Per_Day + t % Nanos_Per_Day;
+}
+
+// 'MM-DD HH:MM:SS.mmm', with nanoseconds if the timestamp has them, as 'logcat -T' takes it.
+std::string format_timestamp(LogcatTimestamp_t t);
+
+
+// Fixed-width per-row metadata. Text fields are kept as offsets into the raw line bytes.
+struct LogcatRow_t
+{
+    LogcatTimestamp_t timestamp;
+    uint32_t offset;            // line start within the block bytes
+    uint32_t size;              // line size in bytes
+    int32_t pid;
+    int32_t tid;
+    uint16_t tag_offset;        // offsets below are relative to the line start
+    uint16_t tag_size;
+    uint16_t message_offset;
+    uint8_t date_size;
+    uint8_t time_offset;
+    uint8_t time_size;
+    uint8_t priority_offset;
+    uint8_t priority_size;
+    LogcatPriority_t priority;
+    uint8_t device;             // index of the capturing device
+};
+
+static_assert(sizeof(LogcatRow_t) <= 40, "LogcatRow_t is expected to stay compact");
+
+
+// Processes of all devices share the process tables, keyed by the device index packed above
+// the PID. The key of a device 0 process is its PID.
+const int Process_Pid_Bits = 22;    // PIDs are below 2^22 on Android
+const int Max_Devices = 64;
+
+inline int process_key(int device, int pid)
+{
+    return device == 0 ? pid : (device << Process_Pid_Bits) | (pid & ((1 << Process_Pid_Bits) - 1));
+}
+
+inline int process_key(const LogcatRow_t& row) { return process_key(row.device, row.pid); }
+
+inline int process_key_pid(int key) { return key >> Process_Pid_Bits > 0 ? key & ((1 << Process_Pid_Bits) - 1) : key; }
+inline int process_key_device(int key) { return key >> Process_Pid_Bits > 0 ? key >> Process_Pid_Bits : 0; }
+
+
+struct LogcatBlock_t
+{
+    std::vector<LogcatRow_t> rows;
+    std::vector<char> bytes;
+};
+
+
+// Blocks that are loaded on first access, e.g. from a mapped capture file. load() may be
+// called from any thread.
+class LogcatBlockSource
+{
+  public:
+    virtual ~LogcatBlockSource() = default;
+
+    virtual size_t blockCount() const = 0;
+    virtual size_t blockRows(size_t block) const = 0;
+    virtual size_t blockBytes(size_t block) const = 0;
+    virtual std::shared_ptr<LogcatBlock_t> load(size_t block) const = 0;
+};
+
+
+// Blocks of a store shared with a background reader. Only sealed (full) blocks are
+// included, they are never modified again and stay alive while the snapshot holds them.
+struct LogcatStoreSnapshot_t
+{
+    std::vector<std::shared_ptr<const LogcatBlock_t>> blocks;
+    size_t head = 0;            // evicted rows in the first block
+    size_t size = 0;            // live rows in the blocks
+    uint64_t first_seq = 0;     // sequence number of the first live row
+    // blocks that were not loaded yet are null, blocks[i] is source block source_first + i
+    std::shared_ptr<const LogcatBlockSource> source;
+    size_t source_first = 0;
+};
+
+
+// Parsed rows on their way into the store, row offsets point into `bytes`.
+struct LogcatBatch_t
+{
+    std::vector<LogcatRow_t> rows;
+    std::vector<char> bytes;
+
+    void clear()
+    {
+        rows.clear();
+        bytes.clear();
+    }
+};
+
+
+// Growable circular buffer, elements are pushed at the back and popped from the front.
+template<typename T>
+class LogcatRing
+{
+  public:
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    T& operator[](size_t i) { return items_[(head_ + i) & (items_.size() - 1)]; }
+    const T& operator[](size_t i) const { return items_[(head_ + i) & (items_.size() - 1)]; }
+    T& front() { return (*this)[0]; }
+    T& back() { return (*this)[size_ - 1]; }
+    const T& back() const { return (*this)[size_ - 1]; }
+
+    void push_back(T&& item)
+    {
+        if (size_ == items_.size()) { grow(); }
+        items_[(head_ + size_) & (items_.size() - 1)] = std::move(item);
+        size_ += 1;
+    }
+
+    void pop_front()
+    {
+        items_[head_] = T();
+        head_ = (head_ + 1) & (items_.size() - 1);
+        size_ -= 1;
+    }
+
+    void clear()
+    {
+        items_.clear();
+        head_ = 0;
+        size_ = 0;
+    }
+
+    size_t capacity() const { return items_.size(); }
+
+  protected:
+    void grow()
+    {
+        auto items = std::vector<T>(items_.empty() ? 16 : items_.size() * 2);
+        for (size_t i = 0; i < size_; ++i) { items[i] = std::move((*this)[i]); }
+        items_ = std::move(items);
+        head_ = 0;
+    }
+
+    std::vector<T> items_;
+    size_t head_ = 0;
+    size_t size_ = 0;
+};
+
+
+// Zero means no limit.
+struct LogcatRetention_t
+{
+    size_t max_rows = 0;
+    size_t max_bytes = 0;
+    int64_t max_age_msecs = 0;
+};
+
+
+// Log store: rows are grouped into blocks of Block_Rows, each block owns the raw bytes
+// of its lines, so a row lookup is two array indexing operations. Rows are appended at
+// the back and evicted from the front, whole blocks are released once fully evicted.
+//
+// Every row also has a sequence number that is not affected by evictions: the row
+// at index i has sequence number firstSeq() + i.
+class LogcatStore
+{
+  public:
+    static const size_t Block_Rows = 4096;
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    uint64_t firstSeq() const { return first_seq_; }
+    uint64_t endSeq() const { return first_seq_ + size_; }
+
+    const LogcatRow_t& row(size_t i) const
+    {
+        const auto n = head_ + i;
+        return block(n / Block_Rows).rows[n % Block_Rows];
+    }
+    const char* line(size_t i) const
+    {
+        const auto n = head_ + i;
+        const auto& b = block(n / Block_Rows);
+        return b.bytes.data() + b.rows[n % Block_Rows].offset;
+    }
+
+    std::string_view date(size_t i) const;
+    std::string_view time(size_t i) const;
+    std::string_view priority(size_t i) const;
+    std::string_view tag(size_t i) const;
+    std::string_view message(size_t i) const;
+
+    // `row` comes from the parser, its offsets are relative to `line`.
+    void append(const char* line, const LogcatRow_t& row);
+    void append(const LogcatBatch_t& batch);
+    void evictFront(size_t count);
+    void clear();
+
+    // Replaces the rows with the ones of `source`, its blocks are loaded on first access
+    // and at most Max_Loaded_Blocks of them are kept. All blocks but the last have to be full.
+    void assign(std::shared_ptr<const LogcatBlockSource> source);
+    static const size_t Max_Loaded_Blocks = 256;
+
+    // The tail block is still being filled and is left out, its rows start at
+    // snapshot.first_seq + snapshot.size.
+    LogcatStoreSnapshot_t sealedSnapshot() const;
+
+    // Number of leading rows to evict to satisfy `retention`.
+    size_t overRetention(const LogcatRetention_t& retention) const;
+
+    // Bytes allocated for rows and line data.
+    size_t memoryUsage() const;
+    // Bytes of the live rows: row metadata plus line data.
+    size_t liveBytes() const { return live_bytes_; }
+
+  protected:
+    const LogcatBlock_t& block(size_t k) const { return blocks_[k] ? *blocks_[k] : loadBlock(k); }
+    const LogcatBlock_t& loadBlock(size_t k) const;
+    size_t blockRows(size_t k) const;
+
+  protected:
+    mutable LogcatRing<std::shared_ptr<LogcatBlock_t>> blocks_;
+    size_t head_ = 0;           // evicted rows in the first block
+    size_t size_ = 0;
+    size_t live_bytes_ = 0;
+    uint64_t first_seq_ = 0;
+
+    std::shared_ptr<const LogcatBlockSource> source_;
+    size_t source_first_ = 0;           // source block of blocks_[0]
+    mutable std::deque<size_t> loaded_; // source blocks loaded on access, oldest first
+};
+
+
+#endif // LOGCATSTORE_H
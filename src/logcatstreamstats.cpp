@@ -0,0 +1,270 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+
+#include "logcatstreamstats.h"
+
+#include <algorithm>
+#include <utility>
+
+
+void LogcatSpaceSaving::add(uint64_t key, uint64_t bytes)
+{
+    if (capacity_ == 0) { return; }
+
+    // lines of a tag or process come in runs
+    if (last_ < 0 || counters_[last_].key != key) {
+        auto it = index_.find(key);
+        last_ = it != index_.end() ? it->second : -1;
+    }
+    if (last_ >= 0) {
+        counters_[last_].bytes += bytes;
+        increment(last_);
+        return;
+    }
+
+    if (counters_.size() < capacity_) {
+        const auto c = static_cast<int>(counters_.size());
+        counters_.push_back({key, 0, 0, bytes});
+        group_.push_back(-1);
+        prev_.push_back(-1);
+        next_.push_back(-1);
+        index_.emplace(key, c);
+        last_ = c;
+        const auto g = min_group_ >= 0 && groups_[min_group_].count == 1 ? min_group_ : insertGroup(1, -1);
+        link(c, g);
+        counters_[c].count = 1;
+        return;
+    }
+
+    // the least frequent key gives its counter up
+    const auto c = groups_[min_group_].first;
+    auto node = index_.extract(counters_[c].key);
+    node.key() = key;
+    index_.insert(std::move(node));
+    last_ = c;
+    counters_[c].key = key;
+    counters_[c].error = counters_[c].count;
+    counters_[c].bytes = bytes;
+    increment(c);
+}
+
+
+void LogcatSpaceSaving::clear()
+{
+    counters_.clear();
+    group_.clear();
+    prev_.clear();
+    next_.clear();
+    groups_.clear();
+    free_groups_.clear();
+    min_group_ = -1;
+    last_ = -1;
+    index_.clear();
+}
+
+
+void LogcatSpaceSaving::increment(int c)
+{
+    const auto g = group_[c];
+    const auto count = groups_[g].count + 1;
+    auto next = groups_[g].next;
+    if (next < 0 || groups_[next].count != count) { next = insertGroup(count, g); }
+
+    unlink(c);
+    link(c, next);
+    counters_[c].count = count;
+    if (groups_[g].first < 0) { removeGroup(g); }
+}
+
+
+void LogcatSpaceSaving::link(int c, int g)
+{
+    group_[c] = g;
+    prev_[c] = -1;
+    next_[c] = groups_[g].first;
+    if (next_[c] >= 0) { prev_[next_[c]] = c; }
+    groups_[g].first = c;
+}
+
+
+void LogcatSpaceSaving::unlink(int c)
+{
+    auto& g = groups_[group_[c]];
+    if (prev_[c] >= 0) { next_[prev_[c]] = next_[c]; } else { g.first = next_[c]; }
+    if (next_[c] >= 0) { prev_[next_[c]] = prev_[c]; }
+    group_[c] = -1;
+}
+
+
+int LogcatSpaceSaving::insertGroup(uint64_t count, int prev)
+{
+    int g = 0;
+    if (! free_groups_.empty()) {
+        g = free_groups_.back();
+        free_groups_.pop_back();
+    } else {
+        g = static_cast<int>(groups_.size());
+        groups_.emplace_back();
+    }
+
+    auto& group = groups_[g];
+    group.count = count;
+    group.first = -1;
+    group.prev = prev;
+    group.next = prev >= 0 ? groups_[prev].next : min_group_;
+    if (group.next >= 0) { groups_[group.next].prev = g; }
+    if (prev >= 0) { groups_[prev].next = g; } else { min_group_ = g; }
+    return g;
+}
+
+
+void LogcatSpaceSaving::removeGroup(int g)
+{
+    const auto& group = groups_[g];
+    if (group.prev >= 0) { groups_[group.prev].next = group.next; } else { min_group_ = group.next; }
+    if (group.next >= 0) { groups_[group.next].prev = group.prev; }
+    free_groups_.push_back(g);
+}
+
+
+LogcatStreamStats::LogcatStreamStats(size_t capacity)
+        : slots_(Max_Window_Secs * 1000 / Slot_Msecs)
+{
+    // there are only a few priorities, their counts are exact
+    for (auto& slot : slots_) {
+        slot.summaries = {LogcatSpaceSaving(capacity), LogcatSpaceSaving(capacity),
+                          LogcatSpaceSaving(std::max<size_t>(capacity, static_cast<size_t>(LogcatPriority_t::Silent) + 1))};
+    }
+}
+
+
+void LogcatStreamStats::add(int64_t now, uint64_t tag, uint64_t process, LogcatPriority_t priority, uint32_t bytes)
+{
+    if (first_ < 0) { first_ = now; }
+
+    const auto index = now / Slot_Msecs;
+    auto& slot = slots_[static_cast<size_t>(index) % slots_.size()];
+    if (slot.index != index) {
+        slot.index = index;
+        slot.lines = 0;
+        slot.bytes = 0;
+        for (auto& summary : slot.summaries) { summary.clear(); }
+    }
+
+    slot.lines += 1;
+    slot.bytes += bytes;
+    slot.summaries[static_cast<size_t>(LogcatStatsKind_t::Tag)].add(tag, bytes);
+    slot.summaries[static_cast<size_t>(LogcatStatsKind_t::Process)].add(process, bytes);
+    slot.summaries[static_cast<size_t>(LogcatStatsKind_t::Priority)].add(static_cast<uint64_t>(priority), bytes);
+}
+
+
+void LogcatStreamStats::clear()
+{
+    for (auto& slot : slots_) {
+        slot.index = -1;
+        slot.lines = 0;
+        slot.bytes = 0;
+        for (auto& summary : slot.summaries) { summary.clear(); }
+    }
+    first_ = -1;
+}
+
+
+double LogcatStreamStats::windowSecs(int64_t now, int window_secs) const
+{
+    // the current slot is only partly over, and the window does not reach before the first line
+    const auto span = static_cast<int64_t>(window_secs - 1) * Slot_Msecs + now % Slot_Msecs + 1;
+    return static_cast<double>(std::max<int64_t>(std::min(span, now - first_ + 1), 1)) / 1000.0;
+}
+
+
+template<typename F>
+void LogcatStreamStats::forEachSlot(int64_t now, int window_secs, F&& func) const
+{
+    const auto index = now / Slot_Msecs;
+    const auto count = std::min(std::max(window_secs, 1), static_cast<int>(slots_.size()));
+    for (const auto& slot : slots_) {
+        if (slot.index <= index && slot.index > index - count) { func(slot); }
+    }
+}
+
+
+LogcatStatsEntry_t LogcatStreamStats::total(int64_t now, int window_secs) const
+{
+    auto entry = LogcatStatsEntry_t();
+    if (first_ < 0) { return entry; }
+
+    uint64_t lines = 0;
+    uint64_t bytes = 0;
+    forEachSlot(now, window_secs, [&lines, &bytes](const Slot_t& slot) {
+        lines += slot.lines;
+        bytes += slot.bytes;
+    });
+    const auto secs = windowSecs(now, window_secs);
+    entry.lines_per_sec = static_cast<double>(lines) / secs;
+    entry.bytes_per_sec = static_cast<double>(bytes) / secs;
+    return entry;
+}
+
+
+std::vector<LogcatStatsEntry_t> LogcatStreamStats::top(LogcatStatsKind_t kind, int64_t now, int window_secs, size_t k) const
+{
+    struct Merged_t
+    {
+        uint64_t count = 0;
+        uint64_t error = 0;
+        uint64_t bytes = 0;
+        uint64_t present_min = 0;   // sum of the minimums of the summaries that count the key
+    };
+
+    auto merged = std::unordered_map<uint64_t, Merged_t>();
+    uint64_t total_min = 0;
+    if (first_ >= 0) {
+        forEachSlot(now, window_secs, [&merged, &total_min, kind](const Slot_t& slot) {
+            const auto& summary = slot.summaries[static_cast<size_t>(kind)];
+            total_min += summary.minCount();
+            for (const auto& c : summary.counters()) {
+                auto& m = merged[c.key];
+                m.count += c.count;
+                m.error += c.error;
+                m.bytes += c.bytes;
+                m.present_min += summary.minCount();
+            }
+        });
+    }
+
+    const auto secs = windowSecs(now, window_secs);
+    auto entries = std::vector<LogcatStatsEntry_t>();
+    entries.reserve(merged.size());
+    for (const auto& item : merged) {
+        const auto missing = total_min - item.second.present_min;
+        auto entry = LogcatStatsEntry_t();
+        entry.key = item.first;
+        entry.lines_per_sec = static_cast<double>(item.second.count + missing) / secs;
+        entry.bytes_per_sec = static_cast<double>(item.second.bytes) / secs;
+        entry.error_per_sec = static_cast<double>(item.second.error + missing) / secs;
+        entries.push_back(entry);
+    }
+
+    const auto n = std::min(k, entries.size());
+    std::partial_sort(entries.begin(), entries.begin() + static_cast<std::ptrdiff_t>(n), entries.end(),
+                      [](const LogcatStatsEntry_t& a, const LogcatStatsEntry_t& b) { return a.lines_per_sec > b.lines_per_sec; });
+    entries.resize(n);
+    return entries;
+}
@@ -0,0 +1,141 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+
+#ifndef LOGCATSTREAMSTATS_H
+#define LOGCATSTREAMSTATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "logcatstore.h"
+
+
+// Space-saving heavy hitter summary: at most `capacity` keys are counted, a new key takes
+// over the counter of the least frequent one and inherits its count as the error. The
+// counters are kept in a stream summary, groups of equal counts in ascending order, so
+// adding a key is O(1).
+class LogcatSpaceSaving
+{
+  public:
+    struct Counter_t
+    {
+        uint64_t key = 0;
+        uint64_t count = 0;         // an upper bound, at most `error` above the true count
+        uint64_t error = 0;
+        uint64_t bytes = 0;         // since the key took over the counter
+    };
+
+    explicit LogcatSpaceSaving(size_t capacity = 64) : capacity_(capacity) {}
+
+    void add(uint64_t key, uint64_t bytes);
+    void clear();
+
+    // Keys that are not counted occurred at most this many times.
+    uint64_t minCount() const { return counters_.size() < capacity_ || min_group_ < 0 ? 0 : groups_[min_group_].count; }
+    // In no particular order.
+    const std::vector<Counter_t>& counters() const { return counters_; }
+
+  private:
+    struct Group_t
+    {
+        uint64_t count = 0;
+        int first = -1;             // counters of the group, linked by next_
+        int prev = -1;              // neighbouring groups
+        int next = -1;
+    };
+
+    void increment(int c);
+    void link(int c, int g);
+    void unlink(int c);
+    int insertGroup(uint64_t count, int prev);
+    void removeGroup(int g);
+
+  private:
+    size_t capacity_;
+    std::vector<Counter_t> counters_;
+    std::vector<int> group_;            // by counter
+    std::vector<int> prev_;
+    std::vector<int> next_;
+    std::vector<Group_t> groups_;
+    std::vector<int> free_groups_;
+    int min_group_ = -1;
+    int last_ = -1;                     // counter of the last key added
+    std::unordered_map<uint64_t, int> index_;
+};
+
+
+enum class LogcatStatsKind_t
+{
+    Tag,
+    Process,
+    Priority
+};
+
+
+struct LogcatStatsEntry_t
+{
+    uint64_t key = 0;
+    double lines_per_sec = 0;
+    double bytes_per_sec = 0;
+    double error_per_sec = 0;       // lines/s may be over by this much
+};
+
+
+// Line and byte rates per tag, process and priority over sliding windows of ingestion time.
+//
+// The time is split into slots of Slot_Msecs, each slot has its own summaries and a line
+// only updates the ones of the current slot. A window merges the summaries of its slots,
+// a key that is missing from a full summary is counted as its minimum.
+class LogcatStreamStats
+{
+  public:
+    static const int Slot_Msecs = 1000;
+    static const int Max_Window_Secs = 60;
+
+    explicit LogcatStreamStats(size_t capacity = 64);
+
+    // `now` is a monotonic time in milliseconds.
+    void add(int64_t now, uint64_t tag, uint64_t process, LogcatPriority_t priority, uint32_t bytes);
+    void clear();
+
+    LogcatStatsEntry_t total(int64_t now, int window_secs) const;
+    // At most `k` heaviest keys by lines over the last `window_secs`, heaviest first.
+    std::vector<LogcatStatsEntry_t> top(LogcatStatsKind_t kind, int64_t now, int window_secs, size_t k) const;
+
+  private:
+    struct Slot_t
+    {
+        int64_t index = -1;         // now / Slot_Msecs
+        uint64_t lines = 0;
+        uint64_t bytes = 0;
+        std::vector<LogcatSpaceSaving> summaries;   // by LogcatStatsKind_t
+    };
+
+    double windowSecs(int64_t now, int window_secs) const;
+    template<typename F>
+    void forEachSlot(int64_t now, int window_secs, F&& func) const;
+
+  private:
+    std::vector<Slot_t> slots_;
+    int64_t first_ = -1;            // time of the first line
+};
+
+
+#endif // LOGCATSTREAMSTATS_H
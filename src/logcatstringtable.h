@@ -0,0 +1,73 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef LOGCATSTRINGTABLE_H
+#define LOGCATSTRINGTABLE_H
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <QString>
+
+
+// Interned strings: every distinct UTF-8 string gets a dense id, id 0 is the empty string.
+// Ids stay valid for the lifetime of the table.
+class LogcatStringTable
+{
+  public:
+    LogcatStringTable() { intern(std::string_view()); }
+
+    int intern(std::string_view utf8)
+    {
+        auto it = ids_.find(utf8);
+        if (it != ids_.end()) { return it->second; }
+
+        const auto id = static_cast<int>(strings_.size());
+        strings_.emplace_back(utf8);
+        display_.push_back(QString::fromUtf8(utf8.data(), static_cast<int>(utf8.size())));
+        ids_.emplace(strings_.back(), id);
+        return id;
+    }
+
+    int intern(const QString& s)
+    {
+        const auto utf8 = s.toUtf8();
+        return intern(std::string_view(utf8.constData(), utf8.size()));
+    }
+
+    // -1 if the string has not been interned
+    int find(std::string_view utf8) const
+    {
+        auto it = ids_.find(utf8);
+        return it != ids_.end() ? it->second : -1;
+    }
+
+    const QString& at(int id) const { return display_[id]; }
+    std::string_view utf8(int id) const { return strings_[id]; }
+    int size() const { return static_cast<int>(strings_.size()); }
+
+  private:
+    std::deque<std::string> strings_;   // stable addresses for the keys of ids_
+    std::vector<QString> display_;
+    std::unordered_map<std::string_view, int> ids_;
+};
+
+
+#endif // LOGCATSTRINGTABLE_H
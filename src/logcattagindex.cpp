@@ -0,0 +1,115 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+
+#include "logcattagindex.h"
+
+#include <algorithm>
+#include <vector>
+
+
+uint32_t LogcatTagIndex::append(uint64_t seq, std::string_view tag, LogcatPriority_t priority)
+{
+    if (end_seq_ == first_seq_) { first_seq_ = seq; }
+
+    if (last_id_ >= tags_.size() || tags_[last_id_].name != tag) {
+        auto it = ids_.find(tag);
+        if (it == ids_.end()) {
+            tags_.push_back({std::string(tag), LogcatRowBitmap()});
+            it = ids_.emplace(tags_.back().name, static_cast<uint32_t>(tags_.size() - 1)).first;
+        }
+        last_id_ = it->second;
+    }
+    tags_[last_id_].rows.add(seq);
+    priorities_[static_cast<int>(priority) < Priority_Count ? static_cast<int>(priority) : 0].add(seq);
+    end_seq_ = seq + 1;
+    return last_id_;
+}
+
+
+void LogcatTagIndex::evictBefore(uint64_t seq)
+{
+    for (auto& tag : tags_) { tag.rows.evictBefore(seq); }
+    for (auto& rows : priorities_) { rows.evictBefore(seq); }
+    first_seq_ = std::min(std::max(first_seq_, seq), end_seq_);
+}
+
+
+void LogcatTagIndex::clear()
+{
+    tags_.clear();
+    ids_.clear();
+    for (auto& rows : priorities_) { rows.clear(); }
+    last_id_ = 0;
+    first_seq_ = 0;
+    end_seq_ = 0;
+}
+
+
+size_t LogcatTagIndex::memoryUsage() const
+{
+    size_t bytes = ids_.size() * (sizeof(std::string_view) + sizeof(uint32_t) + sizeof(void*));
+    for (const auto& tag : tags_) { bytes += sizeof(Tag_t) + tag.name.capacity() + tag.rows.memoryUsage(); }
+    for (const auto& rows : priorities_) { bytes += rows.memoryUsage(); }
+    return bytes;
+}
+
+
+bool LogcatTagIndex::allPriorities(uint32_t priority_mask)
+{
+    const auto all = (1u << Priority_Count) - 1;
+    return (priority_mask & all) == all;
+}
+
+
+LogcatRowBitmap LogcatTagIndex::select(const std::function<bool(std::string_view)>& accepts_tag,
+                                       uint32_t priority_mask) const
+{
+    auto parts = std::vector<const LogcatRowBitmap*>();
+    auto by_priority = LogcatRowBitmap();
+    if (! allPriorities(priority_mask) || ! accepts_tag) {
+        for (int p = 0; p < Priority_Count; ++p) {
+            if (priority_mask & (1u << p)) { parts.push_back(&priorities_[p]); }
+        }
+        by_priority = LogcatRowBitmap::unite(parts);
+        if (! accepts_tag) { return by_priority; }
+    }
+
+    parts.clear();
+    for (const auto& tag : tags_) {
+        if (! tag.rows.empty() && accepts_tag(tag.name)) { parts.push_back(&tag.rows); }
+    }
+    auto by_tag = LogcatRowBitmap::unite(parts);
+    return allPriorities(priority_mask) ? by_tag : LogcatRowBitmap::intersect(by_tag, by_priority);
+}
+
+
+size_t LogcatTagIndex::count(const std::function<bool(std::string_view)>& accepts_tag, uint32_t priority_mask) const
+{
+    // every row has a single tag and priority, so the bitmaps of either kind are disjoint
+    size_t by_priority = 0;
+    for (int p = 0; p < Priority_Count; ++p) {
+        if (priority_mask & (1u << p)) { by_priority += priorities_[p].cardinality(); }
+    }
+    if (! accepts_tag) { return by_priority; }
+
+    size_t by_tag = 0;
+    for (const auto& tag : tags_) {
+        if (! tag.rows.empty() && accepts_tag(tag.name)) { by_tag += tag.rows.cardinality(); }
+    }
+    return std::min(by_tag, by_priority);
+}
@@ -0,0 +1,81 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+
+#ifndef LOGCATTAGINDEX_H
+#define LOGCATTAGINDEX_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "logcatrowbitmap.h"
+#include "logcatstore.h"
+
+
+// Dictionary of the tags of consecutive store rows, with a bitmap of the rows of each tag
+// and of each priority.
+//
+// There are a few thousand distinct tags at most, so a tag test runs once per dictionary
+// entry and the rows of the tags it passes are united, and a priority test is a union of
+// the bitmaps of the priorities it passes.
+class LogcatTagIndex
+{
+  public:
+    static const int Priority_Count = static_cast<int>(LogcatPriority_t::Silent) + 1;
+
+    // Rows have to be appended with consecutive sequence numbers. Returns the tag id.
+    uint32_t append(uint64_t seq, std::string_view tag, LogcatPriority_t priority);
+    // Drops the bitmap parts that only hold rows before `seq`, the dictionary is kept.
+    void evictBefore(uint64_t seq);
+    void clear();
+
+    uint64_t firstSeq() const { return first_seq_; }
+    uint64_t endSeq() const { return end_seq_; }
+    size_t tagCount() const { return tags_.size(); }
+    const std::string& tagName(uint32_t id) const { return tags_[id].name; }
+    size_t memoryUsage() const;
+
+    // Rows whose tag passes `accepts_tag` and whose priority is in `priority_mask`, a bit
+    // per LogcatPriority_t. An empty `accepts_tag` passes all tags.
+    LogcatRowBitmap select(const std::function<bool(std::string_view)>& accepts_tag, uint32_t priority_mask) const;
+    // Upper bound of the rows select() returns, without building the bitmap.
+    size_t count(const std::function<bool(std::string_view)>& accepts_tag, uint32_t priority_mask) const;
+
+  private:
+    struct Tag_t
+    {
+        std::string name;
+        LogcatRowBitmap rows;
+    };
+
+    static bool allPriorities(uint32_t priority_mask);
+
+  private:
+    std::deque<Tag_t> tags_;            // a deque keeps the names in place for the keys of ids_
+    std::unordered_map<std::string_view, uint32_t> ids_;
+    LogcatRowBitmap priorities_[Priority_Count];
+    uint32_t last_id_ = 0;              // rows of a tag come in runs
+    uint64_t first_seq_ = 0;
+    uint64_t end_seq_ = 0;
+};
+
+
+#endif // LOGCATTAGINDEX_H
@@ -0,0 +1,248 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "pch.h"
+#include "logcatteewriter.h"
+
+#include <array>
+
+#include <QDateTime>
+#include <QDir>
+
+
+namespace {
+
+const auto File_Prefix = QStringLiteral("logcat-");
+
+
+std::array<uint32_t, 256> make_crc32_table()
+{
+    auto table = std::array<uint32_t, 256>();
+    for (uint32_t i = 0; i < 256; ++i) {
+        auto c = i;
+        for (int k = 0; k < 8; ++k) { c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1; }
+        table[i] = c;
+    }
+    return table;
+}
+
+
+uint32_t crc32(const QByteArray& data)
+{
+    static const auto table = make_crc32_table();
+    uint32_t c = 0xffffffffu;
+    for (auto b : data) { c = table[(c ^ static_cast<uint8_t>(b)) & 0xff] ^ (c >> 8); }
+    return c ^ 0xffffffffu;
+}
+
+
+void append_le32(QByteArray& out, uint32_t v)
+{
+    for (int i = 0; i < 4; ++i) { out.append(static_cast<char>((v >> (8 * i)) & 0xff)); }
+}
+
+
+// A complete gzip member. qCompress() output is a 4 byte length followed by a zlib stream:
+// a 2 byte header, the raw deflate data and a 4 byte Adler-32 trailer.
+QByteArray gzip_member(const QByteArray& data, int level)
+{
+    const auto zlib = qCompress(data, level);
+    if (zlib.size() < 10) { return QByteArray(); }
+
+    static const char header[] = {'\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, '\xff'};
+    auto out = QByteArray();
+    out.reserve(zlib.size() + 8);
+    out.append(header, sizeof(header));
+    out.append(zlib.constData() + 6, zlib.size() - 10);
+    append_le32(out, crc32(data));
+    append_le32(out, static_cast<uint32_t>(data.size()));
+    return out;
+}
+
+}
+
+
+LogcatTeeWriter::LogcatTeeWriter(const LogcatTeeConfig_t& config)
+        : config_(config)
+        , queue_(Queue_Chunks)
+{
+    thread_ = std::thread([this]() { run(); });
+}
+
+
+LogcatTeeWriter::~LogcatTeeWriter()
+{
+    {
+        auto lock = std::lock_guard<std::mutex>(mutex_);
+        stop_.store(true);
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+
+void LogcatTeeWriter::write(const QByteArray& data)
+{
+    if (data.isEmpty()) { return; }
+
+    bytes_in_.fetch_add(data.size(), std::memory_order_relaxed);
+    auto chunk = data;  // shares the data, no copy
+    if (! queue_.push(std::move(chunk))) {
+        stalls_.fetch_add(1, std::memory_order_relaxed);
+        dropped_bytes_.fetch_add(data.size(), std::memory_order_relaxed);
+    }
+}
+
+
+LogcatTeeStats_t LogcatTeeWriter::stats() const
+{
+    auto s = LogcatTeeStats_t();
+    s.queue_depth = queue_.size();
+    s.queue_capacity = queue_.capacity();
+    s.bytes_in = bytes_in_.load(std::memory_order_relaxed);
+    s.bytes_written = bytes_written_.load(std::memory_order_relaxed);
+    s.files = files_.load(std::memory_order_relaxed);
+    s.stalls = stalls_.load(std::memory_order_relaxed);
+    s.dropped_bytes = dropped_bytes_.load(std::memory_order_relaxed);
+    s.write_errors = write_errors_.load(std::memory_order_relaxed);
+    return s;
+}
+
+
+QString LogcatTeeWriter::currentFile() const
+{
+    auto lock = std::lock_guard<std::mutex>(file_name_mutex_);
+    return file_name_;
+}
+
+
+void LogcatTeeWriter::run()
+{
+    since_flush_.start();
+    for (;;) {
+        // everything pushed before stop() is drained
+        const auto stopping = stop_.load();
+
+        auto chunk = QByteArray();
+        while (queue_.pop(chunk)) {
+            buffer_.append(chunk);
+            if (buffer_.size() >= Write_Buffer_Bytes) { flush(); }
+        }
+        if (! buffer_.isEmpty() && (stopping || since_flush_.elapsed() >= Flush_Msecs)) { flush(); }
+        if (stopping) { break; }
+
+        // the producer does not notify, polling keeps its side wait-free
+        auto lock = std::unique_lock<std::mutex>(mutex_);
+        wake_.wait_for(lock, std::chrono::milliseconds(50), [this]() { return stop_.load(); });
+    }
+    closeFile();
+}
+
+
+void LogcatTeeWriter::flush()
+{
+    since_flush_.restart();
+
+    const auto size_due = config_.max_file_bytes > 0 && file_bytes_ >= config_.max_file_bytes;
+    const auto age_due = config_.max_file_msecs > 0 && file_age_.isValid() && file_age_.elapsed() >= config_.max_file_msecs;
+    if (file_.isOpen() && (size_due || age_due)) {
+        // finish the last complete line in the old file
+        const auto eol = buffer_.lastIndexOf('\n');
+        if (eol >= 0) {
+            writeOut(buffer_.left(eol + 1));
+            buffer_.remove(0, eol + 1);
+        }
+        closeFile();
+    }
+
+    if (buffer_.isEmpty()) { return; }
+    writeOut(buffer_);
+    buffer_.clear();
+}
+
+
+void LogcatTeeWriter::writeOut(const QByteArray& data)
+{
+    if (! file_.isOpen() && ! openFile()) {
+        write_errors_.fetch_add(1, std::memory_order_relaxed);
+        dropped_bytes_.fetch_add(data.size(), std::memory_order_relaxed);
+        return;
+    }
+
+    const auto out = config_.compress ? gzip_member(data, Compress_Level) : data;
+    const auto written = file_.write(out);
+    // hand it to the OS right away, so that it survives a crash of the app
+    if (written != out.size() || ! file_.flush()) {
+        write_errors_.fetch_add(1, std::memory_order_relaxed);
+        closeFile();
+    }
+    if (written > 0) {
+        file_bytes_ += written;
+        bytes_written_.fetch_add(written, std::memory_order_relaxed);
+    }
+}
+
+
+bool LogcatTeeWriter::openFile()
+{
+    auto dir = QDir(config_.directory);
+    if (! dir.mkpath(QStringLiteral("."))) { return false; }
+
+    // names sort by age, the sequence number tells apart files opened within a millisecond
+    const auto stamp = QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-HHmmss-zzz"));
+    const auto suffix = (config_.binary ? QStringLiteral(".bin") : QStringLiteral(".txt"))
+            + (config_.compress ? QStringLiteral(".gz") : QString());
+    auto name = QString();
+    int seq = 0;
+    do {
+        name = QStringLiteral("%1%2-%3%4").arg(File_Prefix, stamp).arg(seq++, 3, 10, QLatin1Char('0')).arg(suffix);
+    } while (dir.exists(name));
+    file_.setFileName(dir.filePath(name));
+    if (! file_.open(QIODevice::WriteOnly | QIODevice::Append)) { return false; }
+
+    file_bytes_ = 0;
+    file_age_.start();
+    files_.fetch_add(1, std::memory_order_relaxed);
+    {
+        auto lock = std::lock_guard<std::mutex>(file_name_mutex_);
+        file_name_ = file_.fileName();
+    }
+    removeOldFiles();
+    return true;
+}
+
+
+void LogcatTeeWriter::closeFile()
+{
+    if (file_.isOpen()) { file_.close(); }
+    file_age_.invalidate();
+}
+
+
+void LogcatTeeWriter::removeOldFiles()
+{
+    if (config_.max_files <= 0) { return; }
+
+    auto dir = QDir(config_.directory);
+    const auto names = dir.entryList({File_Prefix + QStringLiteral("*.txt"), File_Prefix + QStringLiteral("*.txt.gz"),
+                                      File_Prefix + QStringLiteral("*.bin"), File_Prefix + QStringLiteral("*.bin.gz")},
+                                     QDir::Files, QDir::Name);
+    // the time stamps sort the names by age, the current file is the newest one
+    for (int i = 0; i + config_.max_files < names.size(); ++i) {
+        dir.remove(names[i]);
+    }
+}
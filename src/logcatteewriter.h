@@ -0,0 +1,119 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef LOGCATTEEWRITER_H
+#define LOGCATTEEWRITER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+
+#include "logcatspscqueue.h"
+
+
+struct LogcatTeeConfig_t
+{
+    bool enabled = false;
+    QString directory;
+    qint64 max_file_bytes = 64 * 1024 * 1024;   // 0 - no size limit
+    qint64 max_file_msecs = 60 * 60 * 1000;     // 0 - no age limit
+    int max_files = 0;                          // the oldest files are deleted, 0 - keep all
+    bool compress = true;
+    bool binary = false;                        // the stream is 'logcat -B' output, not text
+};
+
+
+struct LogcatTeeStats_t
+{
+    size_t queue_depth = 0;
+    size_t queue_capacity = 0;
+    uint64_t bytes_in = 0;
+    uint64_t bytes_written = 0;     // on disk, after compression
+    uint64_t files = 0;
+    uint64_t stalls = 0;            // chunks that found the queue full and were dropped
+    uint64_t dropped_bytes = 0;
+    uint64_t write_errors = 0;
+};
+
+
+// Appends the raw logcat output to rotated files on its own thread. The producer only
+// enqueues a reference to the data and never waits: when the writer falls behind the
+// chunk is dropped and counted as a stall. Files are rotated by size and age at line
+// boundaries. Compressed files are a sequence of gzip members, one per flush, so the
+// file stays readable by gzip up to the last flush if the app dies.
+class LogcatTeeWriter
+{
+  public:
+    static const size_t Queue_Chunks = 1024;
+    static const int Write_Buffer_Bytes = 1024 * 1024;
+    static const int Flush_Msecs = 1000;
+    static const int Compress_Level = 1;
+
+    explicit LogcatTeeWriter(const LogcatTeeConfig_t& config);
+    ~LogcatTeeWriter();     // writes out everything queued so far
+
+    LogcatTeeWriter(const LogcatTeeWriter&) = delete;
+    LogcatTeeWriter& operator=(const LogcatTeeWriter&) = delete;
+
+    // Producer side, a single thread only.
+    void write(const QByteArray& data);
+
+    LogcatTeeStats_t stats() const;
+    QString currentFile() const;
+
+  private:
+    void run();
+    void flush();
+    void writeOut(const QByteArray& data);
+    bool openFile();
+    void closeFile();
+    void removeOldFiles();
+
+  private:
+    const LogcatTeeConfig_t config_;
+    LogcatSpscQueue<QByteArray> queue_;
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+    std::mutex mutex_;
+    std::condition_variable wake_;
+
+    // writer thread only
+    QByteArray buffer_;
+    QFile file_;
+    qint64 file_bytes_ = 0;
+    QElapsedTimer file_age_;
+    QElapsedTimer since_flush_;
+
+    mutable std::mutex file_name_mutex_;
+    QString file_name_;
+
+    std::atomic<uint64_t> bytes_in_{0};
+    std::atomic<uint64_t> bytes_written_{0};
+    std::atomic<uint64_t> files_{0};
+    std::atomic<uint64_t> stalls_{0};
+    std::atomic<uint64_t> dropped_bytes_{0};
+    std::atomic<uint64_t> write_errors_{0};
+};
+
+
+#endif // LOGCATTEEWRITER_H
@@ -0,0 +1,78 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "logcattimeindex.h"
+
+#include <algorithm>
+#include <limits>
+
+
+void LogcatTimeIndex::append(uint64_t seq, LogcatTimestamp_t timestamp)
+{
+    if (entries_.empty()) {
+        entries_.push_back({seq, timestamp, 0});
+    } else if (seq - entries_.back().first_seq >= Block_Rows) {
+        const auto max = entries_.back().max;
+        entries_.push_back({seq, std::max(max, timestamp), std::max<LogcatTimestamp_t>(0, max - timestamp)});
+    } else {
+        auto& e = entries_.back();
+        e.skew = std::max(e.skew, e.max - timestamp);
+        e.max = std::max(e.max, timestamp);
+    }
+    end_seq_ = seq + 1;
+}
+
+
+void LogcatTimeIndex::evictBefore(uint64_t seq)
+{
+    while (entries_.size() > 1 && entries_[1].first_seq <= seq) {
+        entries_.pop_front();
+    }
+    if (! entries_.empty() && end_seq_ <= seq) {
+        entries_.clear();
+        end_seq_ = seq;
+    }
+}
+
+
+void LogcatTimeIndex::clear()
+{
+    entries_.clear();
+    end_seq_ = 0;
+}
+
+
+std::pair<uint64_t, uint64_t> LogcatTimeIndex::range(LogcatTimestamp_t from, LogcatTimestamp_t to) const
+{
+    if (entries_.empty() || from > to) { return {end_seq_, end_seq_}; }
+
+    // the first block whose running maximum reaches `from` is the first one with such a row
+    const auto first = std::lower_bound(entries_.begin(), entries_.end(), from,
+                                        [](const Entry_t& e, LogcatTimestamp_t t) { return e.max < t; });
+    if (first == entries_.end()) { return {end_seq_, end_seq_}; }
+
+    // a row at or before `to` follows a running maximum of at most `to` plus the skew of its
+    // block, so the blocks after the first one whose running maximum exceeds `to` plus the
+    // largest skew from `first` on hold none
+    LogcatTimestamp_t skew = 0;
+    for (auto it = first; it != entries_.end(); ++it) { skew = std::max(skew, it->skew); }
+    const auto limit = to > std::numeric_limits<LogcatTimestamp_t>::max() - skew
+            ? std::numeric_limits<LogcatTimestamp_t>::max() : to + skew;
+    const auto last = std::upper_bound(first, entries_.end(), limit,
+                                       [](LogcatTimestamp_t t, const Entry_t& e) { return t < e.max; });
+    const auto end = last == entries_.end() || last + 1 == entries_.end() ? end_seq_ : (last + 1)->first_seq;
+    return {first->first_seq, end};
+}
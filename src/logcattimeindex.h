@@ -0,0 +1,68 @@
+//
+// Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef LOGCATTIMEINDEX_H
+#define LOGCATTIMEINDEX_H
+
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+#include "logcatstore.h"
+
+
+// Sparse index over the timestamps of consecutive store rows, an entry per Block_Rows rows.
+//
+// Logcat interleaves several buffers, so timestamps are only nearly sorted. Each entry keeps
+// the running maximum of all timestamps up to its end, which is sorted and finds the first
+// block that can hold a timestamp >= t by binary search. The largest drop of a timestamp
+// below the running maximum within a block bounds how far past a time a row of that block at
+// or before it may show up; the largest one of the blocks in question gives the end of a range
+// the same way, so a burst of skew only widens the ranges while its rows are indexed.
+class LogcatTimeIndex
+{
+  public:
+    static const size_t Block_Rows = 256;
+
+    // Rows have to be appended with consecutive sequence numbers.
+    void append(uint64_t seq, LogcatTimestamp_t timestamp);
+    // Drops the entries that only hold rows before `seq`.
+    void evictBefore(uint64_t seq);
+    void clear();
+
+    uint64_t firstSeq() const { return entries_.empty() ? end_seq_ : entries_.front().first_seq; }
+    uint64_t endSeq() const { return end_seq_; }
+    size_t memoryUsage() const { return entries_.size() * sizeof(Entry_t); }
+
+    // Sequence numbers [first, end) of a range that holds every indexed row with a timestamp
+    // within [from, to], and possibly other rows too. The rows of the first block of the range
+    // are the first ones that may be at or after `from`.
+    std::pair<uint64_t, uint64_t> range(LogcatTimestamp_t from, LogcatTimestamp_t to) const;
+
+  private:
+    struct Entry_t
+    {
+        uint64_t first_seq;
+        LogcatTimestamp_t max;      // of the rows up to the end of the block, not only its own
+        LogcatTimestamp_t skew;     // the largest drop of a row of the block below the running maximum
+    };
+
+    std::deque<Entry_t> entries_;
+    uint64_t end_seq_ = 0;
+};
+
+
+#endif // LOGCATTIMEINDEX_H
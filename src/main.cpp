@@ -17,10 +17,22 @@
 #include "pch.h"
 #include "mainwindow.h"
 
+#include <QMessageBox>
+#include <QProcessEnvironment>
+
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+
+    // the data model only needs it to find adb, a replay runs without it
+    if (! QProcessEnvironment::systemEnvironment().contains(QStringLiteral("ANDROID_SDK_ROOT"))) {
+        QMessageBox msgBox;
+        msgBox.setText(QApplication::translate("main", "Environment variable ANDROID_SDK_ROOT is not set. Fix it and re-launch the app."));
+        msgBox.exec();
+        return 1;
+    }
+
     MainWindow w;
     w.show();
     return a.exec();
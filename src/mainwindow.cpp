@@ -18,7 +18,12 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 
+#include <QFile>
+#include <QFileDialog>
+#include <QFontDatabase>
+#include <QMessageBox>
 #include <QSettings>
+#include <QStandardPaths>
 
 
 MainWindow::MainWindow(QWidget *parent)
@@ -28,18 +33,39 @@ MainWindow::MainWindow(QWidget *parent)
     setWindowFlags(Qt::Window);
     ui->setupUi(this);
     ui->tableView->verticalHeader()->setDefaultSectionSize(20);
+    ui->importProgress->hide();
+    ui->metricsPanel->hide();
+    ui->metricsPanel->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    ui->statsPanel->hide();
+    ui->statsPanel->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
 
     fm = new LogcatFilterProxy(this);
     ui->tableView->setModel(fm);
 
     dm = new LogcatDataModel(this);
     fm->setSourceModel(dm);
+    fm->setMetrics(dm->metrics());
 
     loadSettings();
 
     connect(qApp, &QCoreApplication::aboutToQuit, this, &MainWindow::onAboutToQuit);
     connect(fm, &LogcatFilterProxy::rowsInserted, this, &MainWindow::onRowsInserted);
-    connect(dm, &LogcatDataModel::dataChanged, fm, &LogcatFilterProxy::invalidate);
+    connect(dm, &LogcatDataModel::importProgress, this, &MainWindow::onImportProgress);
+    connect(dm, &LogcatDataModel::importFinished, this, &MainWindow::onImportFinished);
+    connect(dm, &LogcatDataModel::reconnecting, this, &MainWindow::onReconnecting);
+    connect(dm, &LogcatDataModel::reconnected, this, &MainWindow::onReconnected);
+    connect(dm, &LogcatDataModel::devicesChanged, this, &MainWindow::onDevicesChanged);
+    connect(ui->deviceCombo, qOverload<int>(&QComboBox::currentIndexChanged), this, &MainWindow::on_filterBtn_clicked);
+
+    onDevicesChanged();
+    dm->startCapture();
+
+    ui->teeStatus->setVisible(dm->isTeeActive());
+    if (dm->isTeeActive()) {
+        tee_timer_ = new QTimer(this);
+        connect(tee_timer_, &QTimer::timeout, this, &MainWindow::updateTeeStatus);
+        tee_timer_->start(1000);
+    }
 }
 
 
@@ -54,6 +80,28 @@ static const auto win_geometry_str = QStringLiteral("win_geometry");
 static const auto win_maximized_str = QStringLiteral("win_maximized");
 static const auto log_autoscroll_str = QStringLiteral("log_autoscroll");
 static const auto log_col_width_str = QStringLiteral("log_column_widths");
+static const auto ingest_max_rows_str = QStringLiteral("max_rows_per_turn");
+static const auto ingest_max_msecs_str = QStringLiteral("max_msecs_per_turn");
+static const auto ingest_format_str = QStringLiteral("format");
+static const auto ingest_devices_str = QStringLiteral("devices");
+static const auto ingest_reconnect_str = QStringLiteral("reconnect");
+static const auto ingest_reconnect_max_secs_str = QStringLiteral("reconnect_max_seconds");
+static const auto format_binary_str = QStringLiteral("binary");
+static const auto format_text_str = QStringLiteral("text");
+static const auto retention_max_rows_str = QStringLiteral("max_rows");
+static const auto retention_max_mbytes_str = QStringLiteral("max_megabytes");
+static const auto retention_max_minutes_str = QStringLiteral("max_age_minutes");
+static const auto index_max_mbytes_str = QStringLiteral("max_index_megabytes");
+static const auto filter_cache_mbytes_str = QStringLiteral("max_filter_cache_megabytes");
+static const auto tee_enabled_str = QStringLiteral("enabled");
+static const auto tee_directory_str = QStringLiteral("directory");
+static const auto tee_max_mbytes_str = QStringLiteral("max_file_megabytes");
+static const auto tee_max_minutes_str = QStringLiteral("max_file_minutes");
+static const auto tee_max_files_str = QStringLiteral("max_files");
+static const auto tee_compress_str = QStringLiteral("compress");
+static const auto capture_filter_str = QStringLiteral("qLogcat captures (*.qlogcat);;All files (*)");
+static const auto log_filter_str = QStringLiteral("Logcat dumps (*.txt *.log);;All files (*)");
+static const auto metrics_filter_str = QStringLiteral("JSON (*.json);;CSV (*.csv)");
 
 
 void MainWindow::loadSettings()
@@ -66,6 +114,41 @@ void MainWindow::loadSettings()
     ui->autoscrollFlag->setChecked(s.value(log_autoscroll_str, false).toBool());
     ui->tableView->horizontalHeader()->restoreState(s.value(log_col_width_str).toByteArray());
     s.endGroup();
+
+    s.beginGroup(QStringLiteral("Ingestion"));
+    dm->setIngestBudget(s.value(ingest_max_rows_str, dm->ingestMaxRows()).toInt(),
+                        s.value(ingest_max_msecs_str, dm->ingestMaxMsecs()).toInt());
+    const auto binary = s.value(ingest_format_str, format_text_str).toString() == format_binary_str;
+    dm->setLogcatFormat(binary ? LogcatFormat_t::Binary : LogcatFormat_t::Text);
+    dm->setDevices(s.value(ingest_devices_str).toStringList());
+    dm->setReconnect(s.value(ingest_reconnect_str, dm->reconnectEnabled()).toBool(),
+                     s.value(ingest_reconnect_max_secs_str, dm->reconnectMaxMsecs() / 1000).toInt() * 1000);
+    s.endGroup();
+
+    s.beginGroup(QStringLiteral("Retention"));
+    auto retention = LogcatRetention_t();
+    retention.max_rows = s.value(retention_max_rows_str, 0).toULongLong();
+    retention.max_bytes = s.value(retention_max_mbytes_str, 0).toULongLong() * 1024 * 1024;
+    retention.max_age_msecs = s.value(retention_max_minutes_str, 0).toLongLong() * 60 * 1000;
+    dm->setRetention(retention);
+    s.endGroup();
+
+    s.beginGroup(QStringLiteral("Search"));
+    dm->setMessageIndexLimit(s.value(index_max_mbytes_str, 256).toULongLong() * 1024 * 1024);
+    fm->setFilterCacheLimit(s.value(filter_cache_mbytes_str, 64).toULongLong() * 1024 * 1024);
+    s.endGroup();
+
+    s.beginGroup(QStringLiteral("Tee"));
+    auto tee = LogcatTeeConfig_t();
+    const auto default_dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QStringLiteral("/logs");
+    tee.enabled = s.value(tee_enabled_str, false).toBool();
+    tee.directory = s.value(tee_directory_str, default_dir).toString();
+    tee.max_file_bytes = s.value(tee_max_mbytes_str, 64).toLongLong() * 1024 * 1024;
+    tee.max_file_msecs = s.value(tee_max_minutes_str, 60).toLongLong() * 60 * 1000;
+    tee.max_files = s.value(tee_max_files_str, 0).toInt();
+    tee.compress = s.value(tee_compress_str, true).toBool();
+    dm->setTeeConfig(tee);
+    s.endGroup();
 }
 
 
@@ -79,6 +162,36 @@ void MainWindow::saveSettings() const
     s.setValue(log_autoscroll_str, ui->autoscrollFlag->isChecked());
     s.setValue(log_col_width_str, ui->tableView->horizontalHeader()->saveState());
     s.endGroup();
+
+    s.beginGroup(QStringLiteral("Ingestion"));
+    s.setValue(ingest_max_rows_str, dm->ingestMaxRows());
+    s.setValue(ingest_max_msecs_str, dm->ingestMaxMsecs());
+    s.setValue(ingest_format_str, dm->logcatFormat() == LogcatFormat_t::Binary ? format_binary_str : format_text_str);
+    s.setValue(ingest_devices_str, dm->devices());
+    s.setValue(ingest_reconnect_str, dm->reconnectEnabled());
+    s.setValue(ingest_reconnect_max_secs_str, dm->reconnectMaxMsecs() / 1000);
+    s.endGroup();
+
+    s.beginGroup(QStringLiteral("Retention"));
+    s.setValue(retention_max_rows_str, static_cast<qulonglong>(dm->retention().max_rows));
+    s.setValue(retention_max_mbytes_str, static_cast<qulonglong>(dm->retention().max_bytes / (1024 * 1024)));
+    s.setValue(retention_max_minutes_str, static_cast<qlonglong>(dm->retention().max_age_msecs / (60 * 1000)));
+    s.endGroup();
+
+    s.beginGroup(QStringLiteral("Search"));
+    s.setValue(index_max_mbytes_str, static_cast<qulonglong>(dm->messageIndex().memoryLimit() / (1024 * 1024)));
+    s.setValue(filter_cache_mbytes_str, static_cast<qulonglong>(fm->filterCacheLimit() / (1024 * 1024)));
+    s.endGroup();
+
+    s.beginGroup(QStringLiteral("Tee"));
+    const auto& tee = dm->teeConfig();
+    s.setValue(tee_enabled_str, tee.enabled);
+    s.setValue(tee_directory_str, tee.directory);
+    s.setValue(tee_max_mbytes_str, tee.max_file_bytes / (1024 * 1024));
+    s.setValue(tee_max_minutes_str, tee.max_file_msecs / (60 * 1000));
+    s.setValue(tee_max_files_str, tee.max_files);
+    s.setValue(tee_compress_str, tee.compress);
+    s.endGroup();
 }
 
 
@@ -125,6 +238,265 @@ void MainWindow::on_filterBtn_clicked()
         {NAME_Regex, ui->nameFilterEdit->text()},
         {NAME_Regex_Inverted, get_inverted(ui->nameFilterInvertedFlag)},
         {PPID_Regex, ui->ppidFilterEdit->text()},
-        {PPID_Regex_Inverted, get_inverted(ui->ppidFilterInvertedFlag)}
+        {PPID_Regex_Inverted, get_inverted(ui->ppidFilterInvertedFlag)},
+        {MESSAGE_Regex, ui->messageFilterEdit->text()},
+        {MESSAGE_Regex_Inverted, get_inverted(ui->messageFilterInvertedFlag)},
+        {DEVICE_Regex, ui->deviceCombo->currentIndex() > 0
+                ? QStringLiteral("^%1$").arg(QRegularExpression::escape(ui->deviceCombo->currentText()))
+                : regular},
+        {TIME_From, ui->fromTimeEdit->text()},
+        {TIME_To, ui->toTimeEdit->text()}
     });
 }
+
+
+void MainWindow::on_gotoTimeEdit_returnPressed()
+{
+    auto t = LogcatTimestamp_t();
+    auto has_date = false;
+    int64_t precision = 0;
+    const auto& store = dm->store();
+    if (! parse_time_text(ui->gotoTimeEdit->text(), t, has_date, precision) || store.empty()) {
+        QApplication::beep();
+        return;
+    }
+
+    // a time without a date is on the day of the newest row
+    if (! has_date) { t = with_date(t, store.row(store.size() - 1).timestamp); }
+    const auto row = fm->rowAtOrAfter(dm->findTimeRow(t));
+    if (row >= fm->rowCount()) {
+        QApplication::beep();
+        return;
+    }
+
+    ui->autoscrollFlag->setChecked(false);
+    ui->tableView->scrollTo(fm->index(row, 0), QAbstractItemView::PositionAtTop);
+    ui->tableView->selectRow(row);
+}
+
+
+void MainWindow::on_saveBtn_clicked()
+{
+    const auto path = QFileDialog::getSaveFileName(this, tr("Save capture"), QString(), capture_filter_str);
+    if (path.isEmpty()) { return; }
+
+    auto error = QString();
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const auto ok = dm->saveCapture(path, error);
+    QApplication::restoreOverrideCursor();
+    if (! ok) {
+        QMessageBox::warning(this, tr("Save capture"), tr("Cannot save %1:\n%2").arg(path, error));
+    }
+}
+
+
+void MainWindow::on_openBtn_clicked()
+{
+    const auto path = QFileDialog::getOpenFileName(this, tr("Open capture"), QString(), capture_filter_str);
+    if (path.isEmpty()) { return; }
+
+    auto error = QString();
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const auto ok = dm->openCapture(path, error);
+    QApplication::restoreOverrideCursor();
+    if (! ok) {
+        QMessageBox::warning(this, tr("Open capture"), tr("Cannot open %1:\n%2").arg(path, error));
+    }
+}
+
+
+void MainWindow::on_importBtn_clicked()
+{
+    const auto path = QFileDialog::getOpenFileName(this, tr("Import log"), QString(), log_filter_str);
+    if (path.isEmpty()) { return; }
+
+    import_path_ = path;
+    ui->importProgress->setValue(0);
+    ui->importProgress->setVisible(true);
+    dm->importLogFile(path);
+}
+
+
+void MainWindow::onImportProgress(qint64 done, qint64 total)
+{
+    ui->importProgress->setValue(total > 0 ? static_cast<int>(done * 1000 / total) : 0);
+}
+
+
+void MainWindow::onImportFinished(const QString& error)
+{
+    ui->importProgress->setVisible(false);
+    if (! error.isEmpty()) {
+        QMessageBox::warning(this, tr("Import log"), tr("Cannot import %1:\n%2").arg(import_path_, error));
+    }
+}
+
+
+void MainWindow::onDevicesChanged()
+{
+    // a device is picked from the combo box, or by a regex on the DEVICE column
+    const auto multiple = dm->deviceNames().size() > 1;
+    while (ui->deviceCombo->count() > 1) { ui->deviceCombo->removeItem(1); }
+    ui->deviceCombo->addItems(dm->deviceNames());
+    ui->deviceCombo->setVisible(multiple);
+    ui->tableView->setColumnHidden(DEVICE_Column, ! multiple);
+}
+
+
+static QString device_name(const LogcatDataModel* dm, int device)
+{
+    const auto name = dm->deviceNames().value(device);
+    return name.isEmpty() ? MainWindow::tr("Device") : name;
+}
+
+
+void MainWindow::onReconnecting(int device, int exitCode, int attempt, int msecs)
+{
+    ui->captureStatus->setText(tr("%1 disconnected, reconnecting in %2 s")
+                               .arg(device_name(dm, device))
+                               .arg(static_cast<double>(msecs) / 1000, 0, 'f', 1));
+    ui->captureStatus->setToolTip(tr("logcat exited with code %1, attempt %2").arg(exitCode).arg(attempt));
+}
+
+
+void MainWindow::onReconnected(int device)
+{
+    const auto stats = dm->ingestStats();
+    ui->captureStatus->setText(tr("%1 reconnected").arg(device_name(dm, device)));
+    ui->captureStatus->setToolTip(tr("%1 reconnects, %2 repeated rows skipped").arg(stats.reconnects).arg(stats.duplicates));
+}
+
+
+void MainWindow::on_metricsBtn_toggled(bool checked)
+{
+    ui->metricsPanel->setVisible(checked);
+    if (! checked) {
+        if (metrics_timer_) { metrics_timer_->stop(); }
+        return;
+    }
+    if (! metrics_timer_) {
+        metrics_timer_ = new QTimer(this);
+        connect(metrics_timer_, &QTimer::timeout, this, &MainWindow::updateMetricsPanel);
+    }
+    metrics_timer_->start(1000);
+    updateMetricsPanel();
+}
+
+
+void MainWindow::updateMetricsPanel()
+{
+    auto text = QString();
+    for (const auto& m : dm->metricsReport(panel_report_)) {
+        const auto name = QString::fromStdString(m.name).leftJustified(22);
+        const auto unit = QString::fromStdString(m.unit);
+        if (m.is_histogram) {
+            const auto& h = m.histogram;
+            text += QStringLiteral("%1 %2 n=%3  mean=%4  p50=%5  p90=%6  p99=%7  max=%8\n")
+                    .arg(name, unit.leftJustified(6))
+                    .arg(h.count)
+                    .arg(h.mean(), 0, 'f', 0)
+                    .arg(h.quantile(0.50))
+                    .arg(h.quantile(0.90))
+                    .arg(h.quantile(0.99))
+                    .arg(h.max);
+        } else {
+            text += QStringLiteral("%1 %2 %3\n").arg(name, unit.leftJustified(6)).arg(m.value, 0, 'f', m.value < 100 ? 2 : 0);
+        }
+    }
+    ui->metricsPanel->setPlainText(text);
+}
+
+
+void MainWindow::on_statsBtn_toggled(bool checked)
+{
+    ui->statsPanel->setVisible(checked);
+    if (! checked) {
+        if (stats_timer_) { stats_timer_->stop(); }
+        return;
+    }
+    if (! stats_timer_) {
+        stats_timer_ = new QTimer(this);
+        connect(stats_timer_, &QTimer::timeout, this, &MainWindow::updateStatsPanel);
+    }
+    stats_timer_->start(1000);
+    updateStatsPanel();
+}
+
+
+void MainWindow::updateStatsPanel()
+{
+    const int short_secs = 10;
+    const int long_secs = LogcatStreamStats::Max_Window_Secs;
+    const size_t top_k = 10;
+
+    auto rate = [](double lines, double bytes) {
+        return QStringLiteral("%1 lines/s %2 KB/s").arg(lines, 9, 'f', 1).arg(bytes / 1024, 9, 'f', 1);
+    };
+    auto rows = [&rate](const std::vector<LogcatStatsRow_t>& stats) {
+        auto lines = QStringList();
+        for (const auto& s : stats) {
+            auto line = QStringLiteral("  %1 %2").arg(s.name.left(24).leftJustified(24), rate(s.lines_per_sec, s.bytes_per_sec));
+            if (s.error_per_sec >= 0.05) { line += QStringLiteral(" +/-%1").arg(s.error_per_sec, 0, 'f', 1); }
+            lines << line;
+        }
+        return lines;
+    };
+
+    // the short window on the left, the long one on the right
+    auto text = QString();
+    const auto total_short = dm->streamTotals(short_secs);
+    const auto total_long = dm->streamTotals(long_secs);
+    text += QStringLiteral("%1 %2\n")
+            .arg(tr("Last %1 s: %2").arg(short_secs).arg(rate(total_short.lines_per_sec, total_short.bytes_per_sec)).leftJustified(66),
+                 tr("Last %1 s: %2").arg(long_secs).arg(rate(total_long.lines_per_sec, total_long.bytes_per_sec)));
+
+    const std::pair<LogcatStatsKind_t, QString> sections[] = {
+        {LogcatStatsKind_t::Tag, tr("Tags")},
+        {LogcatStatsKind_t::Process, tr("Processes")},
+        {LogcatStatsKind_t::Priority, tr("Priorities")}
+    };
+    for (const auto& section : sections) {
+        const auto left = rows(dm->streamStats(section.first, short_secs, top_k));
+        const auto right = rows(dm->streamStats(section.first, long_secs, top_k));
+        text += QStringLiteral("\n%1\n").arg(section.second);
+        const auto n = std::max(left.size(), right.size());
+        for (auto i = decltype(n)(0); i < n; ++i) {
+            text += QStringLiteral("%1 %2\n").arg(left.value(i).leftJustified(66), right.value(i));
+        }
+    }
+    ui->statsPanel->setPlainText(text);
+}
+
+
+void MainWindow::on_exportMetricsBtn_clicked()
+{
+    auto selected = QString();
+    const auto path = QFileDialog::getSaveFileName(this, tr("Export metrics"), QString(), metrics_filter_str, &selected);
+    if (path.isEmpty()) { return; }
+
+    const auto csv = path.endsWith(QStringLiteral(".csv"), Qt::CaseInsensitive)
+            || (! path.endsWith(QStringLiteral(".json"), Qt::CaseInsensitive) && selected.startsWith(QStringLiteral("CSV")));
+    const auto report = dm->metricsReport(export_report_);
+    const auto data = csv ? metrics_to_csv(report) : metrics_to_json(report);
+
+    auto file = QFile(path);
+    if (! file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+            || file.write(data.data(), static_cast<qint64>(data.size())) != static_cast<qint64>(data.size())) {
+        QMessageBox::warning(this, tr("Export metrics"), tr("Cannot write %1:\n%2").arg(path, file.errorString()));
+    }
+}
+
+
+void MainWindow::updateTeeStatus()
+{
+    const auto stats = dm->teeStats();
+    ui->teeStatus->setText(tr("Tee: %1 MB, %2 stalls")
+                           .arg(static_cast<double>(stats.bytes_written) / (1024 * 1024), 0, 'f', 1)
+                           .arg(stats.stalls));
+    ui->teeStatus->setToolTip(tr("%1\n%2 bytes received, %3 bytes dropped, %4 write errors, %5 files")
+                              .arg(dm->teeFile())
+                              .arg(stats.bytes_in)
+                              .arg(stats.dropped_bytes)
+                              .arg(stats.write_errors)
+                              .arg(stats.files));
+}
@@ -46,11 +46,32 @@ class MainWindow : public QDialog
 
     void on_autosizeBtn_clicked();
     void on_filterBtn_clicked();
+    void on_gotoTimeEdit_returnPressed();
+    void on_saveBtn_clicked();
+    void on_openBtn_clicked();
+    void on_importBtn_clicked();
+    void onImportProgress(qint64 done, qint64 total);
+    void onImportFinished(const QString& error);
+    void updateTeeStatus();
+    void onReconnecting(int device, int exitCode, int attempt, int msecs);
+    void onReconnected(int device);
+    void onDevicesChanged();
+    void on_metricsBtn_toggled(bool checked);
+    void on_exportMetricsBtn_clicked();
+    void updateMetricsPanel();
+    void on_statsBtn_toggled(bool checked);
+    void updateStatsPanel();
 
   private:
     Ui::MainWindow* ui;
     LogcatFilterProxy* fm;
     LogcatDataModel* dm;
+    QString import_path_;
+    QTimer* tee_timer_ = nullptr;
+    QTimer* metrics_timer_ = nullptr;
+    QTimer* stats_timer_ = nullptr;
+    LogcatReportBase_t panel_report_;
+    LogcatReportBase_t export_report_;
 };
 
 
@@ -0,0 +1,97 @@
+#!/bin/sh
+#
+# Copyright 2020 Dmitry Sokolov <mr.dmitry.sokolov@gmail.com>
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+#
+# Stand-in for adb that replays recorded output, to run qLogcat without a device.
+# Copy it to <dir>/platform-tools/adb and start qLogcat with ANDROID_SDK_ROOT=<dir>.
+#
+#   FAKE_ADB_LOGCAT         output of 'adb shell logcat'
+#   FAKE_ADB_LOGCAT_BINARY  output of 'adb exec-out logcat -B', e.g. recorded with
+#                           'adb exec-out logcat -B -d > capture.bin'
+#   FAKE_ADB_PS             output of 'adb shell ps -o USER,PID,PPID,NAME'
+#   FAKE_ADB_EVENT_TAGS     copy of /system/etc/event-log-tags
+#   FAKE_ADB_HOLD           if set, logcat keeps running after the replay like on a device
+#   FAKE_ADB_DEVICES        serials listed by 'adb devices', separated by spaces
+#   FAKE_ADB_SLICE          program run as '<program> <time> <file>' that prints the binary
+#                           records of <file> from the -T time on, binary files are replayed
+#                           whole without it
+#   FAKE_ADB_TZ             timezone of the device, a -T date-time is in it
+#
+# With -s <serial>, a file named <file>.<serial> is replayed instead of <file> if it exists.
+# Without FAKE_ADB_HOLD logcat exits after the replay, like a dropped connection. Lines older
+# than the time given with -T are skipped, so lines appended to the replayed file between
+# the reconnects look like a device that kept logging; 'qLogcatReplay --reconnect <this script>'
+# checks a disconnect and resume that way.
+
+if [ -n "$FAKE_ADB_TZ" ]; then
+    TZ="$FAKE_ADB_TZ"
+    export TZ
+fi
+
+serial=
+while [ $# -gt 0 ]; do
+    case "$1" in
+        devices)
+            echo "List of devices attached"
+            for s in $FAKE_ADB_DEVICES; do printf '%s\tdevice\n' "$s"; done
+            exit 0
+            ;;
+        shell|exec-out) shift; break ;;
+        -s) shift; serial="$1"; [ $# -gt 0 ] && shift ;;
+        *) shift ;;
+    esac
+done
+
+replay() {
+    file=
+    if [ -n "$1" ] && [ -n "$serial" ] && [ -f "$1.$serial" ]; then
+        file="$1.$serial"
+    elif [ -n "$1" ] && [ -f "$1" ]; then
+        file="$1"
+    fi
+    if [ -z "$file" ]; then
+        :
+    elif [ -n "$since" ] && [ -z "$binary" ]; then
+        # 'MM-DD HH:MM:SS.mmm' compares as text
+        awk -v since="$since" '$1 " " $2 >= since' "$file"
+    elif [ -n "$since" ] && [ -n "$FAKE_ADB_SLICE" ]; then
+        "$FAKE_ADB_SLICE" "$since" "$file"
+    else
+        cat "$file"
+    fi
+    if [ -n "$FAKE_ADB_HOLD" ]; then exec sleep 2147483647; fi
+}
+
+case "$1" in
+    logcat)
+        binary=
+        since=
+        prev=
+        for arg in "$@"; do
+            if [ "$arg" = "-B" ]; then binary=1; fi
+            if [ "$prev" = "-T" ]; then since=$(echo "$arg" | tr -d "'"); fi
+            prev="$arg"
+        done
+        if [ -n "$binary" ]; then replay "$FAKE_ADB_LOGCAT_BINARY"; else replay "$FAKE_ADB_LOGCAT"; fi
+        ;;
+    ps)
+        if [ -n "$FAKE_ADB_PS" ]; then cat "$FAKE_ADB_PS"; else echo "USER PID PPID NAME"; fi
+        ;;
+    cat)
+        if [ -n "$FAKE_ADB_EVENT_TAGS" ]; then cat "$FAKE_ADB_EVENT_TAGS"; fi
+        ;;
+esac
+exit 0